@@ -1686,13 +1686,13 @@ bool Comm::restore(int fd)
 	Config::dread(fd, (char *) du, du_layout, dh.nusers);
 	if (dh.tbufsz != 0) {
 	    tbuf = ALLOC(char, dh.tbufsz);
-	    if (P_read(fd, tbuf, dh.tbufsz) != dh.tbufsz) {
+	    if (!Config::read(fd, tbuf, dh.tbufsz)) {
 		fatal("cannot read telnet buffer");
 	    }
 	}
 	if (dh.ubufsz != 0) {
 	    ubuf = ALLOC(char, dh.ubufsz);
-	    if (P_read(fd, ubuf, dh.ubufsz) != dh.ubufsz) {
+	    if (!Config::read(fd, ubuf, dh.ubufsz)) {
 		fatal("cannot read UDP buffer");
 	    }
 	}
@@ -86,6 +86,10 @@ Control::Control()
     vtypes = (char *) NULL;
     vmapsize = 0;
     vmap = (unsigned short *) NULL;
+    switches = (StrSwitch **) NULL;
+    nswitches = 0;
+    swmask = 0;
+    ancestors = (Uint *) NULL;
 }
 
 /*
@@ -164,6 +168,26 @@ Control::~Control()
 	FREE(vmap);
     }
 
+    /* delete ancestor list */
+    if (ancestors != (Uint *) NULL) {
+	FREE(ancestors);
+    }
+
+    /* delete string switch tables */
+    if (switches != (StrSwitch **) NULL) {
+	StrSwitch *sw;
+	Uint i;
+
+	for (i = 0; i <= swmask; i++) {
+	    sw = switches[i];
+	    if (sw != (StrSwitch *) NULL) {
+		FREE(sw->table);
+		FREE(sw);
+	    }
+	}
+	FREE(switches);
+    }
+
     /* delete sectors */
     if (sectors != (Sector *) NULL) {
 	FREE(sectors);
@@ -2655,7 +2679,8 @@ Control *Control::conv(Object *obj, Uint instance,
 	    if (header.flags & CMP_TYPE) {
 		ctrl->prog = Swap::decompress(ctrl->sectors, readv,
 					      header.progsize, size,
-					      &ctrl->progsize);
+					      &ctrl->progsize,
+					      header.flags & CMP_TYPE);
 	    } else {
 		ctrl->prog = ALLOC(char, header.progsize);
 		(*readv)(ctrl->prog, ctrl->sectors, header.progsize, size);
@@ -2686,7 +2711,8 @@ Control *Control::conv(Object *obj, Uint instance,
 		if (header.flags & (CMP_TYPE << 2)) {
 		    ctrl->stext = Swap::decompress(ctrl->sectors, readv,
 						   header.strsize, size,
-						   &ctrl->strsize);
+						   &ctrl->strsize,
+						   (header.flags >> 2) & CMP_TYPE);
 		} else {
 		    ctrl->stext = ALLOC(char, header.strsize);
 		    (*readv)(ctrl->stext, ctrl->sectors, header.strsize, size);
@@ -2753,7 +2779,7 @@ void Control::loadProgram(void (*readv) (char*, Sector*, Uint, Uint))
     if (progsize != 0) {
 	if (flags & CTRL_PROGCMP) {
 	    prog = Swap::decompress(sectors, readv, progsize, progoffset,
-				    &progsize);
+				    &progsize, flags & CTRL_PROGCMP);
 	} else {
 	    prog = ALLOC(char, progsize);
 	    (*readv)(prog, sectors, progsize, progoffset);
@@ -2781,7 +2807,7 @@ void Control::loadStext(void (*readv) (char*, Sector*, Uint, Uint))
     if (flags & CTRL_STRCMP) {
 	stext = Swap::decompress(sectors, readv, strsize,
 				 stroffset + nstrings * sizeof(ssizet),
-				 &strsize);
+				 &strsize, (flags & CTRL_STRCMP) >> 2);
     } else {
 	stext = ALLOC(char, strsize);
 	(*readv)(stext, sectors, strsize,
@@ -3054,7 +3080,7 @@ void Control::save()
 	    prog = ALLOC(char, header.progsize);
 	    size = Swap::compress(prog, this->prog, header.progsize);
 	    if (size != 0) {
-		header.flags |= CMP_PRED;
+		header.flags |= Swap::compression();
 		header.progsize = size;
 	    } else {
 		FREE(prog);
@@ -3091,7 +3117,7 @@ void Control::save()
 	    text = ALLOC(char, header.strsize);
 	    size = Swap::compress(text, stext, header.strsize);
 	    if (size != 0) {
-		header.flags |= CMP_PRED << 2;
+		header.flags |= Swap::compression() << 2;
 		header.strsize = size;
 	    } else {
 		FREE(text);
@@ -3303,6 +3329,59 @@ Symbol *Control::symb(const char *func, unsigned int len)
     return (Symbol *) NULL;
 }
 
+/*
+ * compare two ancestor list entries
+ */
+static int cmp(cvoid *cv1, cvoid *cv2)
+{
+    Uint a, b;
+
+    a = *(Uint *) cv1;
+    b = *(Uint *) cv2;
+    return (a < b) ? -1 : (a > b);
+}
+
+/*
+ * return the inherited program with the given name, or NULL
+ */
+Inherit *Control::ancestor(const char *name)
+{
+    Uint *a, key;
+    short i, l, h, m;
+
+    if (ancestors == (Uint *) NULL) {
+	/* build the ancestor list, sorted by name hash and inherit index */
+	ancestors = ALLOC(Uint, ninherits);
+	for (i = 0; i < ninherits; i++) {
+	    key = Hashtab::hashstr(OBJR(inherits[i].oindex)->name, OBJHASHSZ);
+	    ancestors[i] = (key << 8) | i;
+	}
+	std::qsort(ancestors, ninherits, sizeof(Uint), cmp);
+    }
+
+    /* find the last entry with this hash */
+    key = ((Uint) Hashtab::hashstr(name, OBJHASHSZ) << 8) | 0xff;
+    l = 0;
+    h = ninherits;
+    while (l < h) {
+	m = (l + h) >> 1;
+	if (ancestors[m] <= key) {
+	    l = m + 1;
+	} else {
+	    h = m;
+	}
+    }
+
+    /* search backwards, so that the most recent inherit is found first */
+    for (a = ancestors + l; a != ancestors && (*--a | 0xff) == key; ) {
+	i = *a & 0xff;
+	if (strcmp(name, OBJR(inherits[i].oindex)->name) == 0) {
+	    return &inherits[i];
+	}
+    }
+    return (Inherit *) NULL;
+}
+
 /*
  * list the undefined functions in a program
  */
@@ -51,6 +51,12 @@ struct Symbol {
 
 # define DSYM_LAYOUT	"ccs"
 
+struct StrSwitch {
+    Uint offset;		/* offset of switch table in program */
+    unsigned short mask;	/* hash table size - 1 */
+    unsigned short *table;	/* hash table: hash and case index + 1 */
+};
+
 class Control : public Allocated {
 public:
     void ref();
@@ -67,6 +73,7 @@ public:
     char *varTypes();
     Uint progSize();
     Symbol *symb(const char *func, unsigned int len);
+    Inherit *ancestor(const char *name);
     Array *undefined(Dataspace *data);
 
     static void prepare();
@@ -143,6 +150,11 @@ public:
     unsigned short vmapsize;	/* i/o size of variable mapping */
     unsigned short *vmap;	/* variable mapping */
 
+    StrSwitch **switches;	/* hashed string switch tables, by offset */
+    Uint nswitches;		/* # hashed string switch tables */
+    Uint swmask;		/* size of switches - 1 */
+    Uint *ancestors;		/* inherited programs, sorted by name hash */
+
 private:
     Control();
     virtual ~Control();
@@ -205,11 +217,6 @@ private:
 # define CTRL_UNDEFINED		0x010	/* has undefined functions */
 # define CTRL_VARMAP		0x020	/* varmap updated */
 
-/* data compression */
-# define CMP_TYPE		0x03
-# define CMP_NONE		0x00	/* no compression */
-# define CMP_PRED		0x01	/* predictor compression */
-
 # define PROTO_CLASS(prot)	((prot)[0])
 # define PROTO_NARGS(prot)	((prot)[1])
 # define PROTO_VARGS(prot)	((prot)[2])
@@ -0,0 +1,222 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_Y_TAB_H_INCLUDED
+# define YY_YY_Y_TAB_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    VOID = 258,                    /* VOID  */
+    INHERIT = 259,                 /* INHERIT  */
+    MAPPING = 260,                 /* MAPPING  */
+    BREAK = 261,                   /* BREAK  */
+    ELSE = 262,                    /* ELSE  */
+    CASE = 263,                    /* CASE  */
+    NIL = 264,                     /* NIL  */
+    FOR = 265,                     /* FOR  */
+    STATIC = 266,                  /* STATIC  */
+    CONTINUE = 267,                /* CONTINUE  */
+    PRIVATE = 268,                 /* PRIVATE  */
+    FUNCTION = 269,                /* FUNCTION  */
+    RLIMITS = 270,                 /* RLIMITS  */
+    RETURN = 271,                  /* RETURN  */
+    OPERATOR = 272,                /* OPERATOR  */
+    FLOAT = 273,                   /* FLOAT  */
+    DO = 274,                      /* DO  */
+    IF = 275,                      /* IF  */
+    OBJECT = 276,                  /* OBJECT  */
+    GOTO = 277,                    /* GOTO  */
+    STRING = 278,                  /* STRING  */
+    WHILE = 279,                   /* WHILE  */
+    NEW = 280,                     /* NEW  */
+    VARARGS = 281,                 /* VARARGS  */
+    CATCH = 282,                   /* CATCH  */
+    SWITCH = 283,                  /* SWITCH  */
+    NOMASK = 284,                  /* NOMASK  */
+    ATOMIC = 285,                  /* ATOMIC  */
+    INT = 286,                     /* INT  */
+    DEFAULT = 287,                 /* DEFAULT  */
+    MIXED = 288,                   /* MIXED  */
+    LARROW = 289,                  /* LARROW  */
+    RARROW = 290,                  /* RARROW  */
+    PLUS_PLUS = 291,               /* PLUS_PLUS  */
+    MIN_MIN = 292,                 /* MIN_MIN  */
+    LSHIFT = 293,                  /* LSHIFT  */
+    RSHIFT = 294,                  /* RSHIFT  */
+    LE = 295,                      /* LE  */
+    GE = 296,                      /* GE  */
+    EQ = 297,                      /* EQ  */
+    NE = 298,                      /* NE  */
+    LAND = 299,                    /* LAND  */
+    LOR = 300,                     /* LOR  */
+    PLUS_EQ = 301,                 /* PLUS_EQ  */
+    MIN_EQ = 302,                  /* MIN_EQ  */
+    MULT_EQ = 303,                 /* MULT_EQ  */
+    DIV_EQ = 304,                  /* DIV_EQ  */
+    MOD_EQ = 305,                  /* MOD_EQ  */
+    LSHIFT_EQ = 306,               /* LSHIFT_EQ  */
+    RSHIFT_EQ = 307,               /* RSHIFT_EQ  */
+    AND_EQ = 308,                  /* AND_EQ  */
+    XOR_EQ = 309,                  /* XOR_EQ  */
+    OR_EQ = 310,                   /* OR_EQ  */
+    COLON_COLON = 311,             /* COLON_COLON  */
+    DOT_DOT = 312,                 /* DOT_DOT  */
+    ELLIPSIS = 313,                /* ELLIPSIS  */
+    STRING_CONST = 314,            /* STRING_CONST  */
+    IDENTIFIER = 315,              /* IDENTIFIER  */
+    INT_CONST = 316,               /* INT_CONST  */
+    FLOAT_CONST = 317,             /* FLOAT_CONST  */
+    MARK = 318,                    /* MARK  */
+    HASH = 319,                    /* HASH  */
+    HASH_HASH = 320,               /* HASH_HASH  */
+    INCL_CONST = 321,              /* INCL_CONST  */
+    NR_TOKENS = 322                /* NR_TOKENS  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+/* Token kinds.  */
+#define YYEMPTY -2
+#define YYEOF 0
+#define YYerror 256
+#define YYUNDEF 257
+#define VOID 258
+#define INHERIT 259
+#define MAPPING 260
+#define BREAK 261
+#define ELSE 262
+#define CASE 263
+#define NIL 264
+#define FOR 265
+#define STATIC 266
+#define CONTINUE 267
+#define PRIVATE 268
+#define FUNCTION 269
+#define RLIMITS 270
+#define RETURN 271
+#define OPERATOR 272
+#define FLOAT 273
+#define DO 274
+#define IF 275
+#define OBJECT 276
+#define GOTO 277
+#define STRING 278
+#define WHILE 279
+#define NEW 280
+#define VARARGS 281
+#define CATCH 282
+#define SWITCH 283
+#define NOMASK 284
+#define ATOMIC 285
+#define INT 286
+#define DEFAULT 287
+#define MIXED 288
+#define LARROW 289
+#define RARROW 290
+#define PLUS_PLUS 291
+#define MIN_MIN 292
+#define LSHIFT 293
+#define RSHIFT 294
+#define LE 295
+#define GE 296
+#define EQ 297
+#define NE 298
+#define LAND 299
+#define LOR 300
+#define PLUS_EQ 301
+#define MIN_EQ 302
+#define MULT_EQ 303
+#define DIV_EQ 304
+#define MOD_EQ 305
+#define LSHIFT_EQ 306
+#define RSHIFT_EQ 307
+#define AND_EQ 308
+#define XOR_EQ 309
+#define OR_EQ 310
+#define COLON_COLON 311
+#define DOT_DOT 312
+#define ELLIPSIS 313
+#define STRING_CONST 314
+#define IDENTIFIER 315
+#define INT_CONST 316
+#define FLOAT_CONST 317
+#define MARK 318
+#define HASH 319
+#define HASH_HASH 320
+#define INCL_CONST 321
+#define NR_TOKENS 322
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 100 "parser.y"
+
+    Int number;			/* lex input */
+    Float real;			/* lex input */
+    unsigned short type;	/* internal */
+    class Node *node;		/* internal */
+
+#line 208 "y.tab.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+
+extern YYSTYPE yylval;
+
+
+int yyparse (void);
+
+
+#endif /* !YY_YY_Y_TAB_H_INCLUDED  */
@@ -68,52 +68,70 @@ static Config conf[] = {
 				{ "directory",		STRING_CONST },
 # define DRIVER_OBJECT	9
 				{ "driver_object",	STRING_CONST, TRUE },
-# define DUMP_FILE	10
+# define DUMP_BACKGROUND 10
+				{ "dump_background",	INT_CONST, FALSE, FALSE,
+							0, 1 },
+# define DUMP_FILE	11
 				{ "dump_file",		STRING_CONST },
-# define DUMP_INTERVAL	11
+# define DUMP_INTERVAL	12
 				{ "dump_interval",	INT_CONST },
-# define DYNAMIC_CHUNK	12
+# define DYNAMIC_CHUNK	13
 				{ "dynamic_chunk",	INT_CONST, FALSE, FALSE,
 							1024 },
-# define ED_TMPFILE	13
+# define ED_TMPFILE	14
 				{ "ed_tmpfile",		STRING_CONST },
-# define EDITORS	14
+# define EDITORS	15
 				{ "editors",		INT_CONST, FALSE, FALSE,
 							0, EINDEX_MAX },
-# define HOTBOOT	15
+# define FUNCTION_STATS	16
+				{ "function_stats",	INT_CONST, FALSE, FALSE,
+							0, 1 },
+# define HOTBOOT	17
 				{ "hotboot",		'(' },
-# define INCLUDE_DIRS	16
+# define INCLUDE_DIRS	18
 				{ "include_dirs",	'(' },
-# define INCLUDE_FILE	17
+# define INCLUDE_FILE	19
 				{ "include_file",	STRING_CONST, TRUE },
-# define MODULES	18
+# define MODULES	20
 				{ "modules",		']' },
-# define OBJECTS	19
+# define OBJECTS	21
 				{ "objects",		INT_CONST, FALSE, FALSE,
 							2, UINDEX_MAX },
-# define SECTOR_SIZE	20
+# define RESTORE_REPORT	22
+				{ "restore_report",	INT_CONST, FALSE, FALSE,
+							0, 1 },
+# define RESTORE_THREADS 23
+				{ "restore_threads",	INT_CONST, FALSE, FALSE,
+							1, 64 },
+# define SAVE_BINARY	24
+				{ "save_binary",	INT_CONST, FALSE, FALSE,
+							0, 1 },
+# define SECTOR_SIZE	25
 				{ "sector_size",	INT_CONST, FALSE, FALSE,
 							512, 65535 },
-# define STATIC_CHUNK	21
+# define STATIC_CHUNK	26
 				{ "static_chunk",	INT_CONST },
-# define SWAP_FILE	22
+# define SWAP_COMPRESSION 27
+				{ "swap_compression",	INT_CONST, FALSE, FALSE,
+							CMP_NONE, CMP_LZ },
+# define SWAP_FILE	28
 				{ "swap_file",		STRING_CONST },
-# define SWAP_FRAGMENT	23
+# define SWAP_FRAGMENT	29
 				{ "swap_fragment",	INT_CONST, FALSE, FALSE,
 							0, SW_UNUSED },
-# define SWAP_SIZE	24
+# define SWAP_SIZE	30
 				{ "swap_size",		INT_CONST, FALSE, FALSE,
 							1024, SW_UNUSED },
-# define TELNET_PORT	25
+# define TELNET_PORT	31
 				{ "telnet_port",	'[', FALSE, FALSE,
 							1, USHRT_MAX },
-# define TYPECHECKING	26
+# define TYPECHECKING	32
 				{ "typechecking",	INT_CONST, FALSE, FALSE,
 							0, 2 },
-# define USERS		27
+# define USERS		33
 				{ "users",		INT_CONST, FALSE, FALSE,
 							0, EINDEX_MAX },
-# define NR_OPTIONS	28
+# define NR_OPTIONS	34
 };
 
 
@@ -154,6 +172,35 @@ static int realign;		/* align(eindex) */
 static Uint starttime;		/* start time */
 static Uint elapsed;		/* elapsed time */
 static Uint boottime;		/* boot time */
+static int dpid;		/* background snapshot process */
+static int dfd;			/* background snapshot progress pipe */
+static int dprogress;		/* background snapshot progress */
+static int dreported;		/* progress reported to driver object */
+static int dfinal;		/* unreported result of previous snapshot */
+static bool dchild;		/* in background snapshot process? */
+static int rbufd;		/* snapshot of tables read in advance */
+static char *rbuffer;		/* snapshot tables read in advance */
+static Uint rbufsize;		/* size of snapshot tables */
+static Uint rbufoffset;		/* read offset in snapshot tables */
+static Uint rtime;		/* time spent reading snapshot tables */
+
+/*
+ * return the current time in milliseconds
+ */
+static Uint mtime()
+{
+    unsigned short milli;
+
+    return P_mtime(&milli) * 1000 + milli;
+}
+
+/*
+ * return the number of threads used to read a snapshot
+ */
+static int restoreThreads()
+{
+    return (conf[RESTORE_THREADS].set) ? (int) conf[RESTORE_THREADS].num : 1;
+}
 
 /*
  * restore a snapshot header
@@ -246,6 +293,44 @@ void Config::dumpinit()
     }
 }
 
+/*
+ * report snapshot progress from a background process
+ */
+static void dumpReport(int progress)
+{
+    char c;
+
+    if (dchild) {
+	c = progress;
+	P_write(dfd, &c, 1);
+    }
+}
+
+/*
+ * check on a snapshot written in the background, and optionally wait for
+ * it to finish
+ */
+static void dumpWait(bool wait)
+{
+    char buf[16];
+    int status, n;
+
+    if (dpid != 0) {
+	status = P_wait(dpid, wait);
+	while ((n=P_read(dfd, buf, sizeof(buf))) > 0) {
+	    dprogress = buf[n - 1];
+	}
+	if (status >= 0) {
+	    /* finished */
+	    if (status != 0 || dprogress != 100) {
+		dprogress = -1;
+	    }
+	    P_close(dfd);
+	    dpid = 0;
+	}
+    }
+}
+
 /*
  * dump system state on file
  */
@@ -253,6 +338,11 @@ void Config::dump(bool incr, bool boot)
 {
     int fd;
     Uint etime;
+    bool background;
+    size_t size;
+
+    /* a previous snapshot may still be being written */
+    dumpWait(TRUE);
 
     header.version = FORMAT_VERSION;
     header.typecheck = conf[TYPECHECKING].num;
@@ -279,15 +369,54 @@ void Config::dump(bool incr, bool boot)
 	header.dflags |= FLAGS_PARTIAL;
     }
     fd = Swap::save(conf[DUMP_FILE].str, header.dflags & FLAGS_PARTIAL);
+
+    /*
+     * The state is consistent, and all swap sectors are on file.  Full
+     * snapshots can be completed by a background process, while this
+     * process updates its state without writing anything.
+     */
+    background = (conf[DUMP_BACKGROUND].num != 0 && !incr && !boot);
+    if (background) {
+	dpid = P_fork(&dfd);
+	if (dpid == 0) {
+	    dchild = TRUE;
+	    fd = Swap::reopen(conf[DUMP_FILE].str);
+	} else if (dpid > 0) {
+	    Swap::dryRun(TRUE);
+	    if (dprogress != dreported && dfinal >= 0) {
+		/* report the result of the previous snapshot later */
+		dfinal = dprogress;
+	    }
+	    dprogress = dreported = 0;
+	} else {
+	    background = FALSE;
+	    dpid = 0;
+	}
+    }
+
+    size = 0;
+    if (incr && !boot && !(header.dflags & FLAGS_PARTIAL)) {
+	/* measure tables, so they can be placed in recycled sectors */
+	Swap::dryRun(TRUE);
+	KFun::dump(fd);
+	Object::save(fd, incr);
+	CallOut::save(fd);
+	size = Swap::dryRun(FALSE);
+    }
+    Swap::saveMap(size);
+    dumpReport(20);
     if (!KFun::dump(fd)) {
-	fatal("failed to dump kfun table");
+	dumpError("failed to dump kfun table");
     }
+    dumpReport(40);
     if (!Object::save(fd, incr)) {
-	fatal("failed to dump object table");
+	dumpError("failed to dump object table");
     }
+    dumpReport(60);
     if (!CallOut::save(fd)) {
-	fatal("failed to dump callout table");
+	dumpError("failed to dump callout table");
     }
+    dumpReport(80);
     if (boot) {
 	boot = Comm::save(fd);
 	if (boot) {
@@ -296,6 +425,58 @@ void Config::dump(bool incr, bool boot)
     }
 
     Swap::save2(&header, sizeof(SnapshotInfo), incr);
+
+    if (background) {
+	if (dchild) {
+	    /* snapshot written */
+	    dumpReport(100);
+	    P_exit(0);
+	}
+	Swap::dryRun(FALSE);
+    }
+}
+
+/*
+ * writing a snapshot failed.  A background process exits with a status
+ * that is reported by the main process
+ */
+void Config::dumpError(const char *mesg)
+{
+    if (dchild) {
+	message("Background snapshot: %s\012", mesg);	/* LF */
+	P_exit(1);
+    }
+    fatal("%s", mesg);
+}
+
+/*
+ * check on a snapshot written in the background, and optionally wait for
+ * it to finish.  Return TRUE if there is progress to report: 0-100, or -1
+ * if writing the snapshot failed.  The result of a previous snapshot that
+ * finished unreported is reported first
+ */
+bool Config::dumpProgress(bool wait, int *progress)
+{
+    dumpWait(wait);
+
+    if (dfinal != 0) {
+	*progress = dfinal;
+	dfinal = 0;
+	return TRUE;
+    }
+    if (dprogress != dreported) {
+	*progress = dreported = dprogress;
+	return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * return TRUE if a snapshot is being written in the background
+ */
+bool Config::dumping()
+{
+    return (dpid != 0);
 }
 
 /*
@@ -303,8 +484,9 @@ void Config::dump(bool incr, bool boot)
  */
 bool Config::restore(int fd, int fd2)
 {
-    bool conv_14, conv_15, conv_16;
+    bool conv_14, conv_15, conv_16, hotbooted;
     unsigned int secsize;
+    Uint t0, t1, t2, t3, t4;
 
     secsize = rheader.restore(fd);
     conv_14 = conv_15 = conv_16 = FALSE;
@@ -386,9 +568,14 @@ bool Config::restore(int fd, int fd2)
     }
     rheader.psize &= 0xf;
 
+    rtime = 0;
+    t0 = mtime();
     Swap::restore(fd, secsize);
+    t1 = mtime();
     KFun::restore(fd);
+    t2 = mtime();
     Object::restore(fd, rheader.dflags & FLAGS_PARTIAL);
+    t3 = mtime();
     Dataspace::initConv(conv_14, conv_16);
     Control::initConv(conv_14, conv_15, conv_16);
     if (conv_14) {
@@ -410,12 +597,69 @@ bool Config::restore(int fd, int fd2)
     }
     boottime = P_time();
     CallOut::restore(fd, boottime, conv_16);
+    t4 = mtime();
 
     if (fd2 >= 0) {
 	P_close(fd2);
     }
 
-    return ((rheader.dflags & FLAGS_HOTBOOT) && Comm::restore(fd));
+    hotbooted = ((rheader.dflags & FLAGS_HOTBOOT) && Comm::restore(fd));
+    if (rbuffer != (char *) NULL) {
+	FREE(rbuffer);
+	rbuffer = (char *) NULL;
+    }
+
+    if (conf[RESTORE_REPORT].num != 0) {
+	/* startup report */
+	message("Restored %lu bytes of snapshot tables in %lu ms "
+		"(%d threads)\012",
+		(unsigned long) rbufsize, (unsigned long) rtime,
+		restoreThreads());				/* LF */
+	message("Restore times: swap map %lu ms, kfuns %lu ms, "
+		"objects %lu ms, callouts %lu ms\012",
+		(unsigned long) (t1 - t0 - rtime), (unsigned long) (t2 - t1),
+		(unsigned long) (t3 - t2), (unsigned long) (t4 - t3));	/* LF */
+    }
+
+    return hotbooted;
+}
+
+/*
+ * read the tables of a snapshot in advance, with large reads by several
+ * threads
+ */
+void Config::preload(int fd, Uint size)
+{
+    Uint time;
+    off_t offset;
+
+    time = mtime();
+    offset = P_lseek(fd, 0, SEEK_CUR);
+    rbuffer = ALLOC(char, (size != 0) ? size : 1);
+    if (!P_pread(fd, rbuffer, size, offset, restoreThreads())) {
+	fatal("cannot read snapshot tables");
+    }
+    rbufd = fd;
+    rbufsize = size;
+    rbufoffset = 0;
+    rtime = mtime() - time;
+}
+
+/*
+ * read from snapshot, from the tables read in advance if possible.  Return
+ * TRUE if all was read
+ */
+bool Config::read(int fd, char *buf, unsigned int size)
+{
+    if (rbuffer != (char *) NULL && fd == rbufd) {
+	if (size > rbufsize - rbufoffset) {
+	    return FALSE;
+	}
+	memcpy(buf, rbuffer + rbufoffset, size);
+	rbufoffset += size;
+	return TRUE;
+    }
+    return (P_read(fd, buf, size) == size);
 }
 
 /*
@@ -758,6 +1002,25 @@ Uint Config::dconv(char *buf, char *rbuf, const char *layout, Uint n)
     return (size << 16) | rsize;
 }
 
+struct ConvRange {
+    char *buf;			/* converted entries */
+    char *rbuf;			/* entries in snapshot */
+    const char *layout;		/* layout of entries */
+    Uint n;			/* # entries */
+};
+
+/*
+ * convert a range of entries read from a snapshot
+ */
+static void *convRange(void *arg)
+{
+    ConvRange *r;
+
+    r = (ConvRange *) arg;
+    Config::dconv(r->buf, r->rbuf, r->layout, r->n);
+    return NULL;
+}
+
 /*
  * read from snapshot
  */
@@ -770,12 +1033,42 @@ void Config::dread(int fd, char *buf, const char *layout, Uint n)
     tmp = Config::dsize(layout);
     size = (tmp >> 16) & 0xff;
     rsize = tmp & 0xff;
+
+    if (rbuffer != (char *) NULL && fd == rbufd) {
+	ConvRange range[64];
+	unsigned int nthreads;
+
+	/*
+	 * convert from the tables read in advance, split over several
+	 * threads with at least 256 KB each
+	 */
+	if (n > (rbufsize - rbufoffset) / rsize) {
+	    fatal("cannot read from snapshot");
+	}
+	nthreads = n / (262144 / rsize + 1) + 1;
+	if (nthreads > (unsigned int) restoreThreads()) {
+	    nthreads = restoreThreads();
+	}
+	tmp = (n + nthreads - 1) / nthreads;
+	for (i = 0; i < nthreads; i++) {
+	    range[i].buf = buf;
+	    range[i].rbuf = rbuffer + rbufoffset;
+	    range[i].layout = layout;
+	    range[i].n = (n > tmp) ? tmp : n;
+	    buf += size * range[i].n;
+	    rbufoffset += rsize * range[i].n;
+	    n -= range[i].n;
+	}
+	P_threads(&convRange, range, sizeof(ConvRange), nthreads);
+	return;
+    }
+
     while (n != 0) {
 	i = sizeof(buffer) / rsize;
 	if (i > n) {
 	    i = n;
 	}
-	if (P_read(fd, buffer, i * rsize) != i * rsize) {
+	if (!read(fd, buffer, i * rsize)) {
 	    fatal("cannot read from snapshot");
 	}
 	Config::dconv(buf, buffer, layout, (Uint) i);
@@ -1089,7 +1382,10 @@ bool Config::config()
 
     for (l = 0; l < NR_OPTIONS; l++) {
 	if (!conf[l].set && l != HOTBOOT && l != MODULES && l != CACHE_SIZE &&
-	    l != DATAGRAM_PORT && l != DATAGRAM_USERS) {
+	    l != DATAGRAM_PORT && l != DATAGRAM_USERS &&
+	    l != DUMP_BACKGROUND && l != FUNCTION_STATS &&
+	    l != RESTORE_REPORT && l != RESTORE_THREADS && l != SAVE_BINARY &&
+	    l != SWAP_COMPRESSION) {
 	    char buffer[64];
 
 	    sprintf(buffer, "unspecified option %s", conf[l].name);
@@ -1267,6 +1563,7 @@ bool Config::includes()
     puts("# define O_CALLOUTS\t4\t/* callouts in object */\012");
     puts("# define O_INDEX\t5\t/* unique ID for master object */\012");
     puts("# define O_UNDEFINED\t6\t/* undefined functions */\012");
+    puts("# define O_FUNCSTATS\t7\t/* function call statistics */\012");
 
     puts("\012# define CO_HANDLE\t0\t/* callout handle */\012");
     puts("# define CO_FUNCTION\t1\t/* function name */\012");
@@ -1554,7 +1851,9 @@ bool Config::init(char *configfile, char *snapshot, char *snapshot2,
     /* initialize swap device */
     cache = (Sector) ((conf[CACHE_SIZE].set) ? conf[CACHE_SIZE].num : 100);
     Swap::init(conf[SWAP_FILE].str, (Sector) conf[SWAP_SIZE].num, cache,
-	       (unsigned int) conf[SECTOR_SIZE].num);
+	       (unsigned int) conf[SECTOR_SIZE].num,
+	       (conf[SWAP_COMPRESSION].set) ?
+		(int) conf[SWAP_COMPRESSION].num : CMP_PRED);
 
     /* initialize swapped data handler */
     Dataspace::init();
@@ -1583,7 +1882,9 @@ bool Config::init(char *configfile, char *snapshot, char *snapshot2,
     }
 
     /* initialize interpreter */
-    Frame::init(conf[CREATE].str, conf[TYPECHECKING].num == 2);
+    Frame::init(conf[CREATE].str, conf[TYPECHECKING].num == 2,
+		(conf[FUNCTION_STATS].num != 0) ?
+		 (uindex) conf[OBJECTS].num : 0);
 
     /* initialize compiler */
     Compile::init(conf[AUTO_OBJECT].str,
@@ -1733,6 +2034,14 @@ int Config::typechecking()
     return conf[TYPECHECKING].num;
 }
 
+/*
+ * return TRUE if save_object() should use the binary format
+ */
+bool Config::saveBinary()
+{
+    return (conf[SAVE_BINARY].num != 0);
+}
+
 /*
  * return TRUE if datagram channel can be attached to connections on this port
  */
@@ -1996,6 +2305,15 @@ bool Config::objecti(Dataspace *data, Object *obj, Int idx, Value *v)
 	}
 	break;
 
+    case 7:	/* O_FUNCSTATS */
+	a = Frame::funcStats(data, prog, ctrl);
+	if (a != (Array *) NULL) {
+	    PUT_MAPVAL(v, a);
+	} else {
+	    *v = Value::nil;
+	}
+	break;
+
     default:
 	return FALSE;
     }
@@ -2012,10 +2330,10 @@ Array *Config::object(Dataspace *data, Object *obj)
     Int i;
     Array *a;
 
-    a = Array::createNil(data, 7);
+    a = Array::createNil(data, 8);
     try {
 	ErrorContext::push();
-	for (i = 0, v = a->elts; i < 7; i++, v++) {
+	for (i = 0, v = a->elts; i < 8; i++, v++) {
 	    objecti(data, obj, i, v);
 	}
 	ErrorContext::pop();
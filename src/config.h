@@ -81,14 +81,26 @@ typedef unsigned short kfindex;
 # define BINBUF_SIZE	8192	/* binary/UDP input buffer size */
 # define UDPHASHSZ	10	/* # characters in UDP challenge to hash */
 
+/* files */
+# define FILECACHESZ	16	/* # file extents cached by read_file() */
+# define FILECACHEMAX	(64 * 1024) /* max size of a cached file extent */
+# define DIRCACHESZ	8	/* # directory listings cached by get_dir() */
+# define DIRCACHEMAX	4096	/* max # entries in a cached listing */
+
 /* swap */
 # define SWAPCHUNK	(128 * 1024 * 1024)
 
 /* interpreter */
 # define MIN_STACK	5	/* minimal stack, # arguments in driver calls */
 # define EXTRA_STACK	32	/* extra space in stack frames */
+# define FRAMEPOOLSZ	(4 * 1024 * 1024) /* # values reserved for call frames */
 # define MAX_STRLEN	SSIZET_MAX	/* max string length, >= 65535 */
-# define INHASHSZ	4096	/* instanceof hashtable size */
+# define PROFHASHSZ	4096	/* profiler hashtable size */
+# define PROFSTACKS	65536	/* max # of distinct profiled stacks */
+# define PROFSTACKSZ	4096	/* max size of a profiled stack */
+# define SCANFCACHESZ	512	/* # compiled sscanf formats cached */
+# define SCANFMAXLEN	1024	/* max length of a cached sscanf format */
+# define SCANFHASHSZ	16	/* # characters in sscanf formats to hash */
 
 /* parser */
 # define MAX_AUTOMSZ	6	/* DFA/PDA storage size, in strings */
@@ -159,18 +171,25 @@ public:
     static char	*driver();
     static char	**hotbootExec();
     static int typechecking();
+    static bool saveBinary();
     static unsigned short arraySize();
     static bool attach(int port);
 
     static void dump(bool incr, bool boot);
+    static void dumpError(const char *mesg);
+    static bool dumpProgress(bool wait, int *progress);
+    static bool dumping();
     static Uint dsize(const char *layout);
     static Uint dconv(char *buf, char *rbuf, const char *layout, Uint n);
     static void dread(int fd, char *buf, const char *layout, Uint n);
+    static void preload(int fd, Uint size);
+    static bool read(int fd, char *buf, unsigned int size);
 
     static bool statusi(Frame *f, Int idx, Value *v);
     static Array *status(Frame *f);
     static bool objecti(Dataspace *data, Object *obj, Int idx, Value *v);
     static Array *object(Dataspace *data, Object *obj);
+    static void putval(Value *v, size_t n);
 
     const char *name;	/* name of the option */
     short type;		/* option type */
@@ -192,7 +211,6 @@ private:
     static void puts(const char *str);
     static bool close();
     static bool includes();
-    static void putval(Value *v, size_t n);
 };
 
 /* utility functions */
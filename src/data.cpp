@@ -357,6 +357,7 @@ Dataplane::Dataplane(Dataspace *data, Int level) : level(level)
 		s->str->ref();
 	    } else {
 		s->str = (String *) NULL;
+		s->data = t->data;
 	    }
 	}
     } else {
@@ -1450,7 +1451,8 @@ Dataspace *Dataspace::conv(Object *obj, Uint *counttab,
 	    if (header.flags & CMP_TYPE) {
 		data->stext = Swap::decompress(data->sectors, readv,
 					       header.strsize, size,
-					       &data->strsize);
+					       &data->strsize,
+					       header.flags & CMP_TYPE);
 	    } else {
 		data->stext = ALLOC(char, header.strsize);
 		(*readv)(data->stext, data->sectors, header.strsize, size);
@@ -1495,7 +1497,7 @@ void Dataspace::loadStrings(void (*readv) (char*, Sector*, Uint, Uint))
 	    if (flags & DATA_STRCMP) {
 		stext = Swap::decompress(sectors, readv, strsize,
 				         stroffset + nstrings * sizeof(SString),
-					 &strsize);
+					 &strsize, flags & DATA_STRCMP);
 	    } else {
 		stext = ALLOC(char, strsize);
 		(*readv)(stext, sectors, strsize,
@@ -1537,8 +1539,9 @@ String *Dataspace::string(Uint idx)
 	    if (p->strings == (StrRef *) NULL) {
 		/* initialize string pointers */
 		s = p->strings = ALLOC(StrRef, nstrings);
-		for (i = nstrings; i > 0; --i) {
-		    (s++)->str = (String *) NULL;
+		for (i = nstrings; i > 0; --i, s++) {
+		    s->str = (String *) NULL;
+		    s->data = (Dataspace *) NULL;
 		}
 	    }
 	    s = &p->strings[idx];
@@ -1979,7 +1982,13 @@ void Dataspace::saveValues(SValue *sv, Value *v, unsigned short n)
 
 	    case T_STRING:
 		sv->oindex = 0;
-		sv->string = v->string->primary - base.strings;
+		if (v->string->primary != (StrRef *) NULL &&
+		    v->string->primary->data == this) {
+		    sv->string = v->string->primary - base.strings;
+		} else {
+		    /* appended string, in the merge table */
+		    sv->string = v->string->put(0);
+		}
 		break;
 
 	    case T_FLOAT:
@@ -2003,13 +2012,272 @@ void Dataspace::saveValues(SValue *sv, Value *v, unsigned short n)
     }
 }
 
+struct NewStrings {
+    Uint nstr;			/* # strings in table */
+    Uint nnew;			/* # strings appended */
+    Uint size;			/* size of text appended */
+    Uint tabsize;		/* size of tables for appended strings */
+    String **strs;		/* appended strings */
+    Uint *refs;			/* references to appended strings */
+};
+
+/*
+ * collect strings to append from modified values
+ */
+void Dataspace::newStrings(NewStrings *ns, Value *v, unsigned int n)
+{
+    String *str;
+    Uint i;
+
+    while (n > 0) {
+	if (v->modified && v->type == T_STRING) {
+	    str = v->string;
+	    if (str->primary == (StrRef *) NULL || str->primary->data != this)
+	    {
+		i = str->put(ns->nstr);
+		if (i == ns->nstr) {
+		    /* new string */
+		    if (ns->nnew == ns->tabsize) {
+			ns->strs = REALLOC(ns->strs, String*, ns->tabsize,
+					   ns->tabsize + 64);
+			ns->refs = REALLOC(ns->refs, Uint, ns->tabsize,
+					   ns->tabsize + 64);
+			ns->tabsize += 64;
+		    }
+		    ns->strs[ns->nnew] = str;
+		    ns->refs[ns->nnew++] = 0;
+		    ns->nstr++;
+		    ns->size += str->len;
+		}
+		ns->refs[i - nstrings]++;
+	    }
+	}
+	v++;
+	--n;
+    }
+}
+
+/*
+ * Prepare to save a dataspace block in which strings were added or
+ * removed, but no arrays.  Strings no longer referenced are kept in the
+ * string table, and new strings are appended.  Return FALSE if the block
+ * should be rebuilt instead, because too much of the string table is
+ * unused.
+ */
+bool Dataspace::appendStrings(NewStrings *ns)
+{
+    SString *ss;
+    StrRef *s;
+    ArrRef *a;
+    Uint n, unused, nunused;
+
+    if (sstrings == (SString *) NULL) {
+	loadStrings(Swap::readv);
+    }
+
+    /* update references, and mark removed strings */
+    unused = nunused = 0;
+    for (n = 0, ss = sstrings; n < nstrings; n++, ss++) {
+	if (base.strings != (StrRef *) NULL) {
+	    s = &base.strings[n];
+	    if (s->str != (String *) NULL) {
+		ss->ref = s->ref;
+	    } else if (s->data != (Dataspace *) NULL) {
+		ss->ref = 0;	/* last reference removed */
+	    }
+	}
+	if (ss->ref == 0) {
+	    unused += ss->len;
+	    nunused++;
+	}
+    }
+    if (unused > strsize / 2 || nunused > nstrings / 2) {
+	return FALSE;
+    }
+
+    /* collect new strings */
+    String::merge();
+    ns->nstr = nstrings;
+    ns->nnew = 0;
+    ns->size = 0;
+    ns->tabsize = 0;
+    ns->strs = (String **) NULL;
+    ns->refs = (Uint *) NULL;
+    if (variables != (Value *) NULL && (base.flags & MOD_VARIABLE)) {
+	newStrings(ns, variables, nvariables);
+    }
+    if (base.flags & MOD_ARRAY) {
+	for (n = narrays, a = base.arrays; n > 0; --n, a++) {
+	    if (a->arr != (Array *) NULL && (a->ref & ARR_MOD)) {
+		newStrings(ns, a->arr->elts, a->arr->size);
+	    }
+	}
+    }
+
+    if (ns->nnew != 0) {
+	/* append new strings */
+	sstrings = REALLOC(sstrings, SString, nstrings, ns->nstr);
+	stext = REALLOC(stext, char, strsize, strsize + ns->size);
+	ss = &sstrings[nstrings];
+	for (n = 0; n < ns->nnew; n++, ss++) {
+	    ss->ref = ns->refs[n];
+	    ss->len = ns->strs[n]->len;
+	    memcpy(stext + strsize, ns->strs[n]->text, ss->len);
+	    strsize += ss->len;
+	}
+	FREE(ns->strs);
+	FREE(ns->refs);
+    }
+
+    return TRUE;
+}
+
+/*
+ * save a dataspace block with appended strings, moving it to a larger
+ * vector of sectors if needed
+ */
+void Dataspace::saveAppended()
+{
+    SDataspace header;
+    char *text;
+    Uint size;
+
+    if (ncallouts != 0 && scallouts == (SCallOut *) NULL) {
+	loadCallouts(Swap::readv);
+    }
+
+    /* fill in header */
+    header.flags = 0;
+    header.nvariables = nvariables;
+    header.narrays = narrays;
+    header.eltsize = eltsize;
+    header.nstrings = nstrings;
+    header.strsize = strsize;
+    header.ncallouts = ncallouts;
+    header.fcallouts = fcallouts;
+
+    text = stext;
+    if (header.strsize >= CMPLIMIT) {
+	text = ALLOC(char, header.strsize);
+	size = Swap::compress(text, stext, header.strsize);
+	if (size != 0) {
+	    header.flags |= Swap::compression();
+	    header.strsize = size;
+	} else {
+	    FREE(text);
+	    text = stext;
+	}
+    }
+    flags = header.flags;
+
+    size = sizeof(SDataspace) +
+	   (header.nvariables + header.eltsize) * sizeof(SValue) +
+	   header.narrays * sizeof(SArray) +
+	   header.nstrings * sizeof(SString) +
+	   header.strsize +
+	   header.ncallouts * (Uint) sizeof(SCallOut);
+    if (Swap::mapsize(size) <= nsectors) {
+	/* rewrite from the string table onwards */
+	header.nsectors = nsectors;
+	Swap::writev((char *) &header, sectors, (Uint) sizeof(SDataspace),
+		     (Uint) 0);
+	saveStrings(&header, text);
+    } else {
+	/*
+	 * Move to a larger vector of sectors, with some room to spare for
+	 * strings appended later.
+	 */
+	if (narrays != 0 && sarrays == (SArray *) NULL) {
+	    loadArrays(Swap::readv);
+	}
+	if (eltsize != 0 && selts == (SValue *) NULL) {
+	    loadElts(Swap::readv);
+	}
+	header.nsectors = Swap::alloc(size + size / 8, nsectors, &sectors);
+	nsectors = header.nsectors;
+	OBJ(oindex)->dfirst = sectors[0];
+	saveTables(&header, text);
+    }
+
+    if (text != stext) {
+	FREE(text);
+    }
+}
+
+/*
+ * write all tables of a dataspace block to swap
+ */
+void Dataspace::saveTables(SDataspace *header, char *text)
+{
+    Uint size;
+
+    /* save header */
+    size = sizeof(SDataspace);
+    Swap::writev((char *) header, sectors, size, (Uint) 0);
+    Swap::writev((char *) sectors, sectors,
+		 header->nsectors * (Uint) sizeof(Sector), size);
+    size += header->nsectors * (Uint) sizeof(Sector);
+
+    /* save variables */
+    varoffset = size;
+    Swap::writev((char *) svariables, sectors,
+		 nvariables * (Uint) sizeof(SValue), size);
+    size += nvariables * (Uint) sizeof(SValue);
+
+    /* save arrays */
+    arroffset = size;
+    if (header->narrays > 0) {
+	Swap::writev((char *) sarrays, sectors,
+		     header->narrays * sizeof(SArray), size);
+	size += header->narrays * sizeof(SArray);
+	if (header->eltsize > 0) {
+	    Swap::writev((char *) selts, sectors,
+			 header->eltsize * sizeof(SValue), size);
+	    size += header->eltsize * sizeof(SValue);
+	}
+    }
+
+    /* save strings */
+    stroffset = size;
+    saveStrings(header, text);
+}
+
+/*
+ * write the string table, string text and callouts of a dataspace block
+ * to swap, starting at the string table offset
+ */
+void Dataspace::saveStrings(SDataspace *header, char *text)
+{
+    Uint size;
+
+    size = stroffset;
+    if (header->nstrings > 0) {
+	Swap::writev((char *) sstrings, sectors,
+		     header->nstrings * sizeof(SString), size);
+	size += header->nstrings * sizeof(SString);
+	if (header->strsize > 0) {
+	    Swap::writev(text, sectors, header->strsize, size);
+	    size += header->strsize;
+	}
+    }
+
+    /* save callouts */
+    cooffset = size;
+    if (header->ncallouts > 0) {
+	Swap::writev((char *) scallouts, sectors,
+		     header->ncallouts * (Uint) sizeof(SCallOut), size);
+    }
+}
+
 /*
  * save all values in a dataspace block
  */
 bool Dataspace::save(bool swap)
 {
     SDataspace header;
+    NewStrings ns;
     Uint n;
+    bool append;
 
     if (parser != (Parser *) NULL && !(OBJ(oindex)->flags & O_SPECIAL)) {
 	parser->save();
@@ -2020,13 +2288,21 @@ bool Dataspace::save(bool swap)
 	return FALSE;
     }
 
+    append = FALSE;
+    if (svariables != (SValue *) NULL && base.achange == 0 &&
+	!(base.flags & MOD_NEWCALLOUT) && base.schange != 0 && swap &&
+	!(base.flags & MOD_SAVE)) {
+	/* strings changed, perhaps only appended */
+	append = appendStrings(&ns);
+    }
+
     if (svariables != (SValue *) NULL && base.achange == 0 &&
-	base.schange == 0 && !(base.flags & MOD_NEWCALLOUT)) {
+	!(base.flags & MOD_NEWCALLOUT) && (base.schange == 0 || append)) {
 	bool mod;
 
 	/*
-	 * No strings/arrays added or deleted. Check individual variables and
-	 * array elements.
+	 * No arrays added or deleted, and strings at most appended.  Check
+	 * individual variables and array elements.
 	 */
 	if (base.flags & MOD_VARIABLE) {
 	    /*
@@ -2085,7 +2361,7 @@ bool Dataspace::save(bool swap)
 		a++;
 	    }
 	}
-	if (base.flags & MOD_STRINGREF) {
+	if ((base.flags & MOD_STRINGREF) && base.schange == 0) {
 	    SString *ss;
 	    StrRef *s;
 
@@ -2131,7 +2407,7 @@ bool Dataspace::save(bool swap)
 		co++;
 	    }
 
-	    if (swap) {
+	    if (swap && base.schange == 0) {
 		/* save new (?) fcallouts value */
 		Swap::writev((char *) &fcallouts, sectors,
 			     (Uint) sizeof(uindex),
@@ -2142,6 +2418,20 @@ bool Dataspace::save(bool swap)
 			     ncallouts * (Uint) sizeof(SCallOut), cooffset);
 	    }
 	}
+	if (base.schange != 0) {
+	    /*
+	     * strings appended
+	     */
+	    String::clear();
+	    freeValues();
+	    if (ssindex != (Uint *) NULL) {
+		FREE(ssindex);
+		ssindex = NULL;
+	    }
+	    nstrings = ns.nstr;
+	    saveAppended();
+	    base.schange = 0;
+	}
     } else {
 	SaveData save;
 	char *text;
@@ -2275,7 +2565,7 @@ bool Dataspace::save(bool swap)
 		text = ALLOC(char, header.strsize);
 		size = Swap::compress(text, save.stext, header.strsize);
 		if (size != 0) {
-		    header.flags |= CMP_PRED;
+		    header.flags |= Swap::compression();
 		    header.strsize = size;
 		} else {
 		    FREE(text);
@@ -2294,52 +2584,9 @@ bool Dataspace::save(bool swap)
 	    nsectors = header.nsectors;
 	    OBJ(oindex)->dfirst = sectors[0];
 
-	    /* save header */
-	    size = sizeof(SDataspace);
-	    Swap::writev((char *) &header, sectors, size, (Uint) 0);
-	    Swap::writev((char *) sectors, sectors,
-			 header.nsectors * (Uint) sizeof(Sector), size);
-	    size += header.nsectors * (Uint) sizeof(Sector);
-
-	    /* save variables */
-	    varoffset = size;
-	    Swap::writev((char *) svariables, sectors,
-			 nvariables * (Uint) sizeof(SValue), size);
-	    size += nvariables * (Uint) sizeof(SValue);
-
-	    /* save arrays */
-	    arroffset = size;
-	    if (header.narrays > 0) {
-		Swap::writev((char *) save.sarrays, sectors,
-			     header.narrays * sizeof(SArray), size);
-		size += header.narrays * sizeof(SArray);
-		if (header.eltsize > 0) {
-		    Swap::writev((char *) save.selts, sectors,
-				 header.eltsize * sizeof(SValue), size);
-		    size += header.eltsize * sizeof(SValue);
-		}
-	    }
-
-	    /* save strings */
-	    stroffset = size;
-	    if (header.nstrings > 0) {
-		Swap::writev((char *) save.sstrings, sectors,
-			     header.nstrings * sizeof(SString), size);
-		size += header.nstrings * sizeof(SString);
-		if (header.strsize > 0) {
-		    Swap::writev(text, sectors, header.strsize, size);
-		    size += header.strsize;
-		    if (text != save.stext) {
-			FREE(text);
-		    }
-		}
-	    }
-
-	    /* save callouts */
-	    cooffset = size;
-	    if (header.ncallouts > 0) {
-		Swap::writev((char *) scallouts, sectors,
-			     header.ncallouts * (Uint) sizeof(SCallOut), size);
+	    saveTables(&header, text);
+	    if (text != save.stext) {
+		FREE(text);
 	    }
 	}
 
@@ -206,6 +206,11 @@ private:
     void loadCallouts(void (*readv) (char*, Sector*, Uint, Uint));
     void loadCallouts();
     void saveValues(struct SValue *sv, Value *v, unsigned short n);
+    void newStrings(struct NewStrings *ns, Value *v, unsigned int n);
+    bool appendStrings(struct NewStrings *ns);
+    void saveAppended();
+    void saveTables(struct SDataspace *header, char *text);
+    void saveStrings(struct SDataspace *header, char *text);
     bool save(bool swap);
     void fix(Uint *counttab);
     void refRhs(Value *rhs);
@@ -38,11 +38,13 @@ static Uint dcount;		/* driver object count */
 static Sector fragment;		/* swap fragment parameter */
 static bool rebuild;		/* rebuild swapfile? */
 bool intr;			/* received an interrupt? */
+volatile bool psample;		/* profiler sample due? */
 
 /*
- * call a function in the driver object
+ * call a function in the driver object.  If the function is optional and
+ * does not exist, the arguments are popped and FALSE is returned
  */
-bool DGD::callDriver(Frame *f, const char *func, int narg)
+bool DGD::callDriver(Frame *f, const char *func, int narg, bool optional)
 {
     Object *driver;
     char *driver_name;
@@ -59,6 +61,9 @@ bool DGD::callDriver(Frame *f, const char *func, int narg)
 	dcount = driver->count;
     }
     if (!f->call(driver, (Array *) NULL, func, strlen(func), TRUE, narg)) {
+	if (optional) {
+	    return FALSE;
+	}
 	fatal("missing function in driver object: %s", func);
     }
     return TRUE;
@@ -72,6 +77,14 @@ void DGD::interrupt()
     intr = TRUE;
 }
 
+/*
+ * request a profiler sample
+ */
+void DGD::sample()
+{
+    psample = TRUE;
+}
+
 /*
  * clean up after a task has terminated
  */
@@ -118,6 +131,15 @@ void DGD::endTask()
     }
 
     if (Object::stop) {
+	int progress;
+
+	/* let a snapshot being written in the background finish */
+	while (Config::dumpProgress(TRUE, &progress)) {
+	    if (progress < 0) {
+		message("Background snapshot failed\012");	/* LF */
+	    }
+	}
+
 	Swap::finish();
 	Config::modFinish();
 	Ext::finish();
@@ -158,6 +180,7 @@ int DGD::main(int argc, char **argv)
     char *program, *module;
     Uint rtime, timeout;
     unsigned short rmtime, mtime;
+    int progress;
 
     rmtime = 0;
 
@@ -220,8 +243,27 @@ int DGD::main(int argc, char **argv)
 	    endTask();
 	}
 
+	/* snapshot written in the background */
+	if (Config::dumpProgress(FALSE, &progress)) {
+	    try {
+		ErrorContext::push((ErrorContext::Handler) errHandler);
+		PUSH_INTVAL(cframe, progress);
+		if (callDriver(cframe, "snapshot_progress", 1, TRUE)) {
+		    (cframe->sp++)->del();
+		}
+		ErrorContext::pop();
+	    } catch (...) { }
+	    endTask();
+	}
+
 	/* handle user input */
 	timeout = CallOut::delay(rtime, rmtime, &mtime);
+	if (Config::dumping() &&
+	    ((timeout == 0 && mtime == 0xffff) || timeout >= 1)) {
+	    /* poll the background snapshot once per second */
+	    timeout = 1;
+	    mtime = 0;
+	}
 	Comm::receive(cframe, timeout, mtime);
 
 	/* callouts */
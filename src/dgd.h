@@ -46,8 +46,10 @@ typedef Uuint Time;
 
 class DGD {
 public:
-    static bool callDriver(Frame *frame, const char *func, int narg);
+    static bool callDriver(Frame *frame, const char *func, int narg,
+			   bool optional = FALSE);
     static void interrupt();
+    static void sample();
     static void endTask();
     static void errHandler(Frame *f, Int depth);
     static int main(int argc, char **argv);
@@ -55,3 +57,4 @@ public:
 
 
 extern bool intr;
+extern volatile bool psample;
@@ -1854,7 +1854,7 @@ void Ext::compile(const Frame *f, Control *ctrl)
 /*
  * JIT-compile and execute a function
  */
-bool Ext::execute(const Frame *f, int func)
+bool Ext::execute(Frame *f, int func)
 {
     Control *ctrl;
     int result;
@@ -1866,6 +1866,9 @@ bool Ext::execute(const Frame *f, int func)
     if (ctrl->instance == 0) {
 	return FALSE;
     }
+    if (f->vargs) {
+	f->varargs();	/* JIT code expects the array */
+    }
 
     if (!setjmp(*ErrorContext::push())) {
 	result = (*jit_execute)(ctrl->oindex, ctrl->instance, ctrl->version,
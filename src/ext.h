@@ -19,7 +19,7 @@
 class Ext {
 public:
     static void kfuns(char *protos, int size, int nkfun);
-    static bool execute(const Frame *f, int func);
+    static bool execute(Frame *f, int func);
     static void release(uint64_t index, uint64_t instance);
     static bool load(char *module, char *config, void (**fdlist)(int*, int),
 		     void (**finish)());
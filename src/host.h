@@ -239,6 +239,8 @@ typedef unsigned int Uint;
 # endif
 
 extern void  P_message	(const char*);
+extern void *P_vreserve	(size_t, size_t);
+extern void  P_threads	(void *(*)(void*), void*, size_t, int);
 
 # ifndef O_BINARY
 # define O_BINARY	0
@@ -283,6 +285,8 @@ extern int P_rmdir	(const char*);
 extern int P_chdir	(const char*);
 extern int P_execv	(const char*, char**);
 # endif
+
+extern bool P_pread	(int, char*, Uint, off_t, int);
 # endif /* INCLUDE_FILE_IO */
 
 extern bool  P_opendir	(const char*);
@@ -298,9 +302,15 @@ extern voidf *P_dload	(char*, const char*);
 extern void  P_srandom	(long);
 extern long  P_random	();
 
+extern int   P_fork	(int*);
+extern int   P_wait	(int, bool);
+extern void  P_exit	(int);
+
 extern Uint  P_time	();
 extern Uint  P_mtime	(unsigned short*);
+extern Uuint P_utime	();
 extern char *P_ctime	(char*, Uint);
+extern void  P_profile	(Uint);
 
 /* these must be the same on all hosts */
 # define BEL	'\007'
@@ -52,9 +52,11 @@ public:
 
 private:
     void mult1(Uint a, Uint b);
+    void multBasic(Asi &x, Asi &y);
     void multInner(Asi &x, Asi &y, Asi &t);
     bool multRow(Asi &x, Uint y);
     void sqr1(Uint a);
+    void sqrBasic(Asi &x);
     Uint div1(Uint a);
     void monpro(Asi &x, Asi &y, Asi &n, Asi &t, Uint n0);
     void powqmod(Asi &a, Asi &b, Asi &mod, Asi &t);
@@ -252,23 +254,29 @@ void Asi::mult1(Uint a, Uint b)
     size = 2;
 }
 
+# define KARATSUBA	32	/* # words below which to multiply directly */
+
+/*
+ * compute x * y, one row at a time
+ */
+void Asi::multBasic(Asi &x, Asi &y)
+{
+    Uint i;
+
+    memset(num, '\0', (x.size + y.size) * sizeof(Uint));
+    for (i = 0; i < y.size; i++) {
+	Asi(num + i, 0).multRow(x, y.num[i]);
+    }
+}
+
 /*
  * compute x * y (x.size - y.size <= 1)
  * t.size = (x.size + y.size) << 1
  */
 void Asi::multInner(Asi &x, Asi &y, Asi &t)
 {
-    if (y.size == 1) {
-	/* x.size <= 2, y.size == 1 */
-	mult1(x.num[0], y.num[0]);
-	if (x.size > 1) {
-	    /* x.size == 2, y.size == 1 */
-	    t.mult1(x.num[1], y.num[0]);
-	    if ((num[1] += t.num[0]) < t.num[0]) {
-		t.num[1]++;
-	    }
-	    num[2] = t.num[1];
-	}
+    if (y.size < KARATSUBA) {
+	multBasic(x, y);
     } else {
 	Asi x0(x.num, x.size >> 1);
 	Asi x1(x.num + x0.size, x.size - x0.size);
@@ -365,14 +373,13 @@ void Asi::mult(Asi &x, Asi &y, Asi &t1)
 
 	Asi c(a.num, b.size);
 	t1.multInner(c, b, t2);
-	z.size = t1.size;
 	z.add(t1);
 	a.num += b.size;
 	a.size -= b.size;
 	z.num += b.size;
+	z.size -= b.size;
     }
     t1.multInner(a, b, t2);
-    z.size = t1.size;
     z.add(t1);
 }
 
@@ -381,6 +388,24 @@ void Asi::mult(Asi &x, Asi &y, Asi &t1)
  */
 bool Asi::multRow(Asi &x, Uint y)
 {
+# ifdef Uuint
+    Uint *a, *b, sz;
+    Uuint t;
+
+    a = num;
+    b = x.num;
+    sz = x.size;
+    t = 0;
+    do {
+	t += (Uuint) *b++ * y + *a;
+	*a++ = (Uint) t;
+	t >>= 32;
+    } while (--sz != 0);
+
+    t += *a;
+    *a = (Uint) t;
+    return (bool) (t >> 32);
+# else
     Uint *a, *b, sz, s, carry;
     Uint tmp[2];
     Asi t(tmp, 2);
@@ -402,6 +427,7 @@ bool Asi::multRow(Asi &x, Uint y)
 
     carry = ((s += carry) < carry);
     return (bool) (carry + ((*a += s) < s));
+# endif
 }
 
 void Asi::sqr1(Uint a)
@@ -432,14 +458,41 @@ void Asi::sqr1(Uint a)
     size = 2;
 }
 
+/*
+ * x * x, computing each cross product only once
+ */
+void Asi::sqrBasic(Asi &x)
+{
+    Uint i, tmp[2];
+    Asi sq(tmp, 2);
+
+    size = x.size << 1;
+    memset(num, '\0', size * sizeof(Uint));
+
+    /* cross products */
+    for (i = 1; i < x.size; i++) {
+	Asi row(x.num + i, x.size - i);
+	Asi(num + (i << 1) - 1, 0).multRow(row, x.num[i - 1]);
+    }
+
+    /* double them, and add the squares */
+    if (x.size > 1) {
+	lshift(1);
+    }
+    for (i = 0; i < x.size; i++) {
+	sq.sqr1(x.num[i]);
+	Asi(num + (i << 1), size - (i << 1)).add(sq);
+    }
+}
+
 /*
  * x * x
  * t.size = x.size << 2
  */
 void Asi::sqr(Asi &x, Asi &t)
 {
-    if (x.size == 1) {
-	sqr1(x.num[0]);
+    if (x.size < KARATSUBA) {
+	sqrBasic(x);
     } else {
 	Asi x0(x.num, x.size >> 1);
 	Asi x1(x.num + x0.size, x.size - x0.size);
@@ -961,7 +1014,8 @@ void Asi::pow2mod(Asi &a, Asi &b, Uint size, Asi &t)
     }
 
     /* remove leading zeroes from b */
-    for (sizeb = size; b.num[sizeb - 1] == 0; --sizeb) {
+    for (sizeb = (b.size < size) ? b.size : size; b.num[sizeb - 1] == 0;
+	 --sizeb) {
 	if (sizeb == 1) {
 	    /* a ** 0 = 1 */
 	    memset(num, '\0', size * sizeof(Uint));
@@ -1056,6 +1110,9 @@ void Asi::power(Asi &a, Asi &b, Asi &mod, Asi &t)
 	/* q = mod >> j */
 	q.copy(mod);
 	q.rshift((size << 5) + i);
+	while (q.num[q.size - 1] == 0) {
+	    --q.size;
+	}
 
 	/* size = number of words, i = mask */
 	if (i != 0) {
@@ -1279,6 +1336,7 @@ String *Asi::numtostr(bool minus)
 	tmp = ALLOCA(Uint, sz);
 	memset(tmp, '\0', sz * sizeof(Uint));
 	Asi t(tmp, sz);
+	size = sz;
 	t.sub(*this);
 	copy(t);
 
@@ -1288,7 +1346,7 @@ String *Asi::numtostr(bool minus)
 	    len = 0;
 	} else {
 	    /* skip leading 0xff bytes */
-	    for (len = 24; UCHAR(bits >> len) == 0xff; len -= 8) ;
+	    for (len = 24; len != 0 && UCHAR(bits >> len) == 0xff; len -= 8) ;
 	    if (!((bits >> len) & 0x80)) {
 		prefix = TRUE;
 	    }
@@ -23,6 +23,10 @@
 # include <math.h>
 
 
+# if FLT_RADIX == 2 && DBL_MANT_DIG == 53 && DBL_MAX_EXP == 1024
+# define IEEE_DOUBLE	/* a Float is the upper 48 bits of a double */
+# endif
+
 /* constants */
 
 Float max_int =		{ 0x41df, 0xffffffc0L };	/* 0x7fffffff */
@@ -53,6 +57,15 @@ static double f_get(const Float *flt)
 {
     double d;
 
+# ifdef IEEE_DOUBLE
+    if ((flt->high & 0x7ff0) != 0) {
+	Uuint bits;
+
+	bits = ((Uuint) flt->high << 48) | ((Uuint) flt->low << 16);
+	memcpy(&d, &bits, sizeof(double));
+	return d;
+    }
+# endif
     if ((flt->high | flt->low) == 0) {
 	return 0.0;
     } else {
@@ -71,6 +84,25 @@ static bool f_put(Float *flt, double d)
     int e;
     Uuint m;
 
+# ifdef IEEE_DOUBLE
+    memcpy(&m, &d, sizeof(double));
+    if (((m >> 52) & 0x7ff) - 1 < 0x7fe) {
+	Uuint rest;
+
+	/* normalized: round to 36 bits of mantissa, to nearest even */
+	rest = m & 0xffff;
+	m -= rest;
+	if (rest > 0x8000 || (rest == 0x8000 && (m & 0x10000))) {
+	    m += 0x10000;
+	    if (((m >> 52) & 0x7ff) == 0x7ff) {
+		return FALSE;
+	    }
+	}
+	flt->high = (unsigned short) (m >> 48);
+	flt->low = (Uint) (m >> 16);
+	return TRUE;
+    }
+# endif
     if (d == 0.0) {
 	flt->high = 0;
 	flt->low = 0;
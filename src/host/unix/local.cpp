@@ -17,8 +17,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+# define INCLUDE_FILE_IO
 # include "dgd.h"
+# include <fcntl.h>
 # include <signal.h>
+# include <pthread.h>
+# include <sys/wait.h>
+# include <sys/mman.h>
 
 extern "C" {
 
@@ -56,3 +61,185 @@ void P_message(const char *mess)
     fputs(mess, stderr);
     fflush(stderr);
 }
+
+/*
+ * call a function for each of n arguments of the given size, with a
+ * thread for each, up to 64
+ */
+void P_threads(void *(*func)(void*), void *args, size_t size, int n)
+{
+    pthread_t thread[64];
+    int i;
+
+    if (n > 64) {
+	n = 64;
+    }
+    for (i = 1; i < n; i++) {
+	if (pthread_create(&thread[i], NULL, func,
+			   (char *) args + i * size) != 0) {
+	    thread[i] = 0;
+	}
+    }
+
+    /* first argument is handled by this thread */
+    (*func)(args);
+    for (i = 1; i < n; i++) {
+	if (thread[i] != 0) {
+	    pthread_join(thread[i], NULL);
+	} else {
+	    (*func)((char *) args + i * size);
+	}
+    }
+}
+
+struct ReadRange {
+    int fd;			/* file descriptor */
+    char *buf;			/* buffer */
+    Uint size;			/* size of range */
+    off_t offset;		/* file offset of range */
+    bool done;			/* successfully read? */
+};
+
+/*
+ * read a range of a file in large chunks
+ */
+static void *readRange(void *arg)
+{
+    ReadRange *r;
+    Uint size;
+    ssize_t n;
+
+    r = (ReadRange *) arg;
+    while (r->size != 0) {
+	size = (r->size > 1024 * 1024) ? 1024 * 1024 : r->size;
+	n = pread(r->fd, r->buf, size, r->offset);
+	if (n <= 0) {
+	    r->done = FALSE;
+	    return NULL;
+	}
+	r->buf += n;
+	r->size -= n;
+	r->offset += n;
+    }
+    r->done = TRUE;
+    return NULL;
+}
+
+/*
+ * read a range of a file, split over several threads.  Return TRUE if
+ * successful
+ */
+bool P_pread(int fd, char *buf, Uint size, off_t offset, int nthreads)
+{
+    ReadRange range[64];
+    Uint part;
+    int i, n;
+    bool done;
+
+    /* at least 1 MB per thread */
+    n = size / (1024 * 1024) + 1;
+    if (n > nthreads) {
+	n = nthreads;
+    }
+    if (n > 64) {
+	n = 64;
+    }
+    part = (size + n - 1) / n;
+    for (i = 0; i < n; i++) {
+	range[i].fd = fd;
+	range[i].buf = buf;
+	range[i].size = (size > part) ? part : size;
+	range[i].offset = offset;
+	buf += range[i].size;
+	offset += range[i].size;
+	size -= range[i].size;
+    }
+
+    P_threads(&readRange, range, sizeof(ReadRange), n);
+    done = TRUE;
+    for (i = 0; i < n; i++) {
+	done &= range[i].done;
+    }
+    return done;
+}
+
+/*
+ * reserve a region of memory, followed by an inaccessible guard region.
+ * Pages are committed when first used.  Return NULL on failure
+ */
+void *P_vreserve(size_t size, size_t guard)
+{
+    size_t page;
+    char *mem;
+
+    page = sysconf(_SC_PAGESIZE);
+    size = ALGN(size, page);
+    guard = ALGN(guard, page);
+    mem = (char *) mmap(NULL, size + guard, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (mem == (char *) MAP_FAILED) {
+	return NULL;
+    }
+    if (mprotect(mem + size, guard, PROT_NONE) != 0) {
+	munmap(mem, size + guard);
+	return NULL;
+    }
+    return mem;
+}
+
+/*
+ * start a child process, with a pipe from the child to the parent.  Return
+ * the process ID in the parent, 0 in the child, or -1 on failure
+ */
+int P_fork(int *fd)
+{
+    int pfd[2];
+    pid_t pid;
+
+    if (pipe(pfd) < 0) {
+	return -1;
+    }
+    pid = fork();
+    if (pid < 0) {
+	close(pfd[0]);
+	close(pfd[1]);
+	return -1;
+    }
+    if (pid == 0) {
+	close(pfd[0]);
+	*fd = pfd[1];
+    } else {
+	close(pfd[1]);
+	fcntl(pfd[0], F_SETFL, O_NONBLOCK);
+	*fd = pfd[0];
+    }
+    return pid;
+}
+
+/*
+ * wait for a child process to finish.  Return its exit status, or -1 if
+ * it is still running
+ */
+int P_wait(int pid, bool block)
+{
+    int status;
+
+    switch (waitpid(pid, &status, (block) ? 0 : WNOHANG)) {
+    case 0:
+	return -1;
+
+    case -1:
+	return 1;
+
+    default:
+	return (WIFEXITED(status)) ? WEXITSTATUS(status) : 1;
+    }
+}
+
+/*
+ * terminate a child process
+ */
+void P_exit(int status)
+{
+    _exit(status);
+}
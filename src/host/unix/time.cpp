@@ -20,6 +20,7 @@
 # include "dgd.h"
 # include <time.h>
 # include <sys/time.h>
+# include <signal.h>
 
 /*
  * return the current time
@@ -41,6 +42,17 @@ Uint P_mtime(unsigned short *milli)
     return (Uint) time.tv_sec;
 }
 
+/*
+ * return a monotonic clock in microseconds
+ */
+Uuint P_utime()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (Uuint) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
 /*
  * convert the given time to a string
  */
@@ -69,3 +81,38 @@ char *P_ctime(char *buf, Uint time)
     }
     return buf;
 }
+
+extern "C" {
+
+/*
+ * profiler timer expired
+ */
+static void profile(int arg)
+{
+    UNREFERENCED_PARAMETER(arg);
+
+    DGD::sample();
+}
+
+}
+
+/*
+ * start or stop the profiler timer, which expires after every usec
+ * microseconds of CPU time
+ */
+void P_profile(Uint usec)
+{
+    struct sigaction act;
+    struct itimerval timer;
+
+    if (usec != 0) {
+	memset(&act, '\0', sizeof(struct sigaction));
+	act.sa_handler = profile;
+	act.sa_flags = SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	sigaction(SIGPROF, &act, (struct sigaction *) NULL);
+    }
+    timer.it_interval.tv_sec = timer.it_value.tv_sec = usec / 1000000;
+    timer.it_interval.tv_usec = timer.it_value.tv_usec = usec % 1000000;
+    setitimer(ITIMER_PROF, &timer, (struct itimerval *) NULL);
+}
@@ -17,6 +17,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+# include <windows.h>
+# define INCLUDE_FILE_IO
 # include "dgd.h"
 
 /*
@@ -34,3 +36,89 @@ long P_random()
 {
     return (long) (rand() ^ (rand() << 9) ^ (rand() << 16));
 }
+
+/*
+ * call a function for each of n arguments of the given size, one after
+ * the other
+ */
+void P_threads(void *(*func)(void*), void *args, size_t size, int n)
+{
+    while (n > 0) {
+	(*func)(args);
+	args = (char *) args + size;
+	--n;
+    }
+}
+
+/*
+ * read a range of a file.  Return TRUE if successful
+ */
+bool P_pread(int fd, char *buf, Uint size, off_t offset, int nthreads)
+{
+    int n;
+
+    UNREFERENCED_PARAMETER(nthreads);
+    if (P_lseek(fd, offset, SEEK_SET) != offset) {
+	return FALSE;
+    }
+    while (size != 0) {
+	n = P_read(fd, buf, (size > 1024 * 1024) ? 1024 * 1024 : size);
+	if (n <= 0) {
+	    return FALSE;
+	}
+	buf += n;
+	size -= n;
+    }
+    return TRUE;
+}
+
+/*
+ * reserve a region of memory, followed by an inaccessible guard region.
+ * Pages are committed when first used.  Return NULL on failure
+ */
+void *P_vreserve(size_t size, size_t guard)
+{
+    SYSTEM_INFO info;
+    char *mem;
+
+    GetSystemInfo(&info);
+    size = ALGN(size, info.dwPageSize);
+    guard = ALGN(guard, info.dwPageSize);
+    mem = (char *) VirtualAlloc(NULL, size + guard, MEM_RESERVE,
+				PAGE_NOACCESS);
+    if (mem == NULL) {
+	return NULL;
+    }
+    if (VirtualAlloc(mem, size, MEM_COMMIT, PAGE_READWRITE) == NULL) {
+	VirtualFree(mem, 0, MEM_RELEASE);
+	return NULL;
+    }
+    return mem;
+}
+
+/*
+ * child processes are not supported
+ */
+int P_fork(int *fd)
+{
+    UNREFERENCED_PARAMETER(fd);
+    return -1;
+}
+
+/*
+ * wait for a child process
+ */
+int P_wait(int pid, bool block)
+{
+    UNREFERENCED_PARAMETER(pid);
+    UNREFERENCED_PARAMETER(block);
+    return 1;
+}
+
+/*
+ * terminate a child process
+ */
+void P_exit(int status)
+{
+    exit(status);
+}
@@ -54,6 +54,22 @@ Uint P_mtime(unsigned short *milli)
     return (Uint) (time / 10000000);
 }
 
+/*
+ * return a monotonic clock in microseconds
+ */
+Uuint P_utime()
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+	QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (Uuint) (count.QuadPart / freq.QuadPart) * 1000000 +
+	   (Uuint) (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
+
 /*
  * return time as string
  */
@@ -85,3 +101,34 @@ char *P_ctime(char *buf, Uint time)
     }
     return buf;
 }
+
+static HANDLE ptimer;	/* profiler timer */
+
+/*
+ * profiler timer expired
+ */
+static VOID CALLBACK profile(PVOID arg, BOOLEAN fired)
+{
+    UNREFERENCED_PARAMETER(arg);
+    UNREFERENCED_PARAMETER(fired);
+
+    DGD::sample();
+}
+
+/*
+ * start or stop the profiler timer, which expires every usec microseconds
+ */
+void P_profile(Uint usec)
+{
+    DWORD msec;
+
+    if (ptimer != NULL) {
+	DeleteTimerQueueTimer(NULL, ptimer, NULL);
+	ptimer = NULL;
+    }
+    if (usec != 0) {
+	msec = (usec + 999) / 1000;
+	CreateTimerQueueTimer(&ptimer, NULL, profile, NULL, msec, msec,
+			      WT_EXECUTEDEFAULT);
+    }
+}
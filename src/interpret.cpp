@@ -18,6 +18,7 @@
  */
 
 # include "dgd.h"
+# include "hash.h"
 # include "str.h"
 # include "array.h"
 # include "object.h"
@@ -34,19 +35,40 @@
 # endif
 
 
+# define FRAMESZ	((sizeof(Frame) + sizeof(Value) - 1) / sizeof(Value))
+# define FRAMEMAX	(FRAMESZ + 0xffff + MIN_STACK + EXTRA_STACK)
+
 static Value stack[MIN_STACK];	/* initial stack */
+static Value *fpool;		/* frames of local function calls */
+static Value *fptop;		/* top of frame pool */
+static Value *fpend;		/* end of frame pool, followed by guard region */
 static Frame topframe;		/* top frame */
 static RLInfo rlim;		/* top rlimits info */
 Frame *cframe;			/* current frame */
 static char *creator;		/* creator function name */
 static unsigned int clen;	/* creator function name length */
 static bool stricttc;		/* strict typechecking */
-static char ihash[INHASHSZ];	/* instanceof hashtable */
+static Hashtab *ptab;		/* profiled stacks */
+static Uint pstacks;		/* # profiled stacks */
+
+struct ProfStack : public Hashtab::Entry {
+    Uint count;			/* # samples */
+};
+
+struct FuncStats {
+    Uint count;			/* program object count */
+    Uint compiled;		/* program compile time */
+    unsigned short nfuncdefs;	/* # function definitions */
+    Uuint *stats;		/* calls, ticks and usec per function */
+};
+
+static FuncStats *fstats;	/* function statistics per program */
+static uindex nfstats;		/* size of fstats, 0 if disabled */
 
 /*
  * initialize the interpreter
  */
-void Frame::init(char *create, bool flag)
+void Frame::init(char *create, bool flag, uindex stats)
 {
     topframe.oindex = OBJ_NONE;
     topframe.fp = topframe.sp = ::stack + MIN_STACK;
@@ -60,9 +82,22 @@ void Frame::init(char *create, bool flag)
     topframe.atomic = FALSE;
     cframe = &topframe;
 
+    fpool = (Value *) P_vreserve(FRAMEPOOLSZ * sizeof(Value),
+				 FRAMEMAX * sizeof(Value));
+    if (fpool == (Value *) NULL) {
+	fatal("cannot reserve frame pool");
+    }
+    fptop = fpool;
+    fpend = fpool + FRAMEPOOLSZ;
+
     creator = create;
     clen = strlen(create);
     stricttc = flag;
+    nfstats = stats;
+    if (stats != 0) {
+	fstats = ALLOC(FuncStats, stats);
+	memset(fstats, '\0', stats * sizeof(FuncStats));
+    }
 
     Value::init(stricttc);
 }
@@ -76,11 +111,24 @@ void Frame::growStack(int size)
 	int spsize;
 	Value *v, *stk;
 
+	spsize = fp - sp;
+	size = ALGN(spsize + size + MIN_STACK, 8);
+	if (sos && heap && fp == fptop && stack + size <= fpend) {
+	    /*
+	     * top of the frame pool: extend in place
+	     */
+	    v = stack + size;
+	    if (spsize != 0) {
+		memmove(v - spsize, sp, spsize * sizeof(Value));
+	    }
+	    sp = v - spsize;
+	    fp = fptop = v;
+	    return;
+	}
+
 	/*
 	 * extend the local ::stack
 	 */
-	spsize = fp - sp;
-	size = ALGN(spsize + size + MIN_STACK, 8);
 	stk = ALLOC(Value, size);
 
 	/* move stack values */
@@ -92,8 +140,10 @@ void Frame::growStack(int size)
 
 	/* replace old stack */
 	if (sos) {
-	    /* stack on stack: alloca'd */
-	    AFREE(stack);
+	    /* stack on stack: alloca'd, or part of the frame */
+	    if (!heap) {
+		AFREE(stack);
+	    }
 	    sos = FALSE;
 	} else if (stack != ::stack) {
 	    FREE(stack);
@@ -196,7 +246,7 @@ void Frame::objDest(Object *obj)
 	    /*
 	     * wipe out objects in arguments to atomic function call
 	     */
-	    for (n = f->nargs, v = prev->sp; n != 0; --n, v++) {
+	    for (n = f->nvargs + f->nargs, v = prev->sp; n != 0; --n, v++) {
 		switch (v->type) {
 		case T_OBJECT:
 		    if (v->oindex == index) {
@@ -445,38 +495,20 @@ char *Frame::className(Uint sclass)
 /*
  * is an object an instance of the named program?
  */
-int Frame::instanceOf(unsigned int oindex, char *prog, Uint hash)
+int Frame::instanceOf(unsigned int oindex, char *prog)
 {
-    char *h;
-    unsigned short i;
-    Inherit *inh;
     Object *obj;
-    Control *ctrl;
+    Inherit *inh;
 
-    /* first try hash table */
     obj = OBJR(oindex);
     if (!(obj->flags & O_MASTER)) {
-	oindex = obj->master;
-	obj = OBJR(oindex);
+	obj = OBJR(obj->master);
     }
-    ctrl = obj->control();
-    h = &ihash[((oindex << 2) ^ hash) % INHASHSZ];
-    if (*h < ctrl->ninherits &&
-	strcmp(OBJR(ctrl->inherits[UCHAR(*h)].oindex)->name, prog) == 0) {
-	return (ctrl->inherits[UCHAR(*h)].priv) ? -1 : 1;	/* found it */
-    }
-
-    /* next, search for it the hard way */
-    for (i = ctrl->ninherits, inh = ctrl->inherits + i; i != 0; ) {
-	--i;
-	--inh;
-	if (strcmp(prog, OBJR(inh->oindex)->name) == 0) {
-	    /* found it; update hashtable */
-	    *h = i;
-	    return (ctrl->inherits[i].priv) ? -1 : 1;
-	}
+    inh = obj->control()->ancestor(prog);
+    if (inh == (Inherit *) NULL) {
+	return FALSE;
     }
-    return FALSE;
+    return (inh->priv) ? -1 : 1;
 }
 
 /*
@@ -484,7 +516,7 @@ int Frame::instanceOf(unsigned int oindex, char *prog, Uint hash)
  */
 int Frame::instanceOf(unsigned int oindex, Uint sclass)
 {
-    return instanceOf(oindex, className(sclass), sclass);
+    return instanceOf(oindex, className(sclass));
 }
 
 /*
@@ -516,14 +548,6 @@ int Frame::instanceOf(Uint sclass)
     return instance;
 }
 
-/*
- * is an object an instance of the named program?
- */
-int Frame::instanceOf(unsigned int oindex, char *prog)
-{
-    return instanceOf(oindex, prog, Hashtab::hashstr(prog, OBJHASHSZ));
-}
-
 /*
  * cast a value to a type
  */
@@ -572,9 +596,31 @@ void Frame::cast(Value *val, unsigned int type, Uint sclass)
  */
 void Frame::storeParam(int param, Value *val)
 {
+    if (param == 0) {
+	vargs = FALSE;
+    }
     data->assignVar(argp + param, val);
 }
 
+/*
+ * create the array of variable arguments, which were left on the stack
+ */
+void Frame::varargs()
+{
+    Array *a;
+    Value *v, *w;
+    unsigned short n;
+
+    a = Array::create(data, nvargs);
+    for (n = nvargs, v = a->elts, w = argp; n != 0; --n) {
+	*v++ = *--w;
+	*w = Value::nil;
+    }
+    Dataspace::refImports(a);
+    PUT_ARRVAL(argp, a);
+    vargs = FALSE;
+}
+
 /*
  * assign a value to a local variable
  */
@@ -1277,9 +1323,9 @@ void Frame::setRlimits(RLInfo *rlim)
 Frame *Frame::setSp(Value *sp)
 {
     Value *v;
-    Frame *f;
+    Frame *f, *prev;
 
-    for (f = this; ; f = f->prev) {
+    for (f = this; ; f = prev) {
 	v = f->sp;
 	for (;;) {
 	    if (v == sp) {
@@ -1297,10 +1343,16 @@ Frame *Frame::setSp(Value *sp)
 	}
 	if (f->sos) {
 	    /* stack on stack */
-	    AFREE(f->stack);
+	    if (!f->heap) {
+		AFREE(f->stack);
+	    }
 	} else if (f->oindex != OBJ_NONE) {
 	    FREE(f->stack);
 	}
+	prev = f->prev;
+	if (f->heap) {
+	    release(f);
+	}
     }
 }
 
@@ -1423,6 +1475,31 @@ void Frame::typecheck(Frame *f, const char *name, const char *ftype,
     }
 }
 
+# define SWITCH_DENSE	8	/* minimum # cases for a jump table */
+# define SWITCH_HASHED	16	/* minimum # cases for a hashed switch */
+
+/*
+ * fetch a case label of sz bytes
+ */
+static Int switchLabel(char *p, unsigned short sz)
+{
+    Int num;
+
+    switch (sz) {
+    case 1:
+	return FETCH1S(p);
+
+    case 2:
+	return FETCH2S(p, num);
+
+    case 3:
+	return FETCH3S(p, num);
+
+    default:
+	return FETCH4S(p, num);
+    }
+}
+
 /*
  * handle an int switch
  */
@@ -1441,6 +1518,19 @@ unsigned short Frame::switchInt(char *pc)
 
     l = 0;
     --h;
+    if (h >= SWITCH_DENSE) {
+	num = switchLabel(pc, sz);
+	l = h - 1;
+	if ((Uint) switchLabel(pc + (sz + 2) * l, sz) - (Uint) num == l) {
+	    /* consecutive case labels: use as jump table */
+	    if ((Uint) sp->number - (Uint) num >= h) {
+		return dflt;
+	    }
+	    p = pc + (sz + 2) * (Uint) (sp->number - num) + sz;
+	    return FETCH2U(p, l);
+	}
+	l = 0;
+    }
     switch (sz) {
     case 1:
 	while (l < h) {
@@ -1596,6 +1686,81 @@ unsigned short Frame::switchRange(char *pc)
     return dflt;
 }
 
+# define SWHASH(offset)	((offset) ^ ((offset) >> 7))
+
+/*
+ * get the hash table for a large string switch, building it on first use
+ */
+StrSwitch *Frame::strSwitch(char *pc, unsigned short n)
+{
+    StrSwitch *sw, **tab;
+    Uint offset, size, i, j;
+    unsigned short hash, m, u, u2;
+    String *str;
+    char *p;
+
+    /* find the table by the offset of the switch in the program */
+    offset = pc - p_ctrl->prog;
+    if (p_ctrl->switches != (StrSwitch **) NULL) {
+	for (i = SWHASH(offset) & p_ctrl->swmask;
+	     (sw = p_ctrl->switches[i]) != (StrSwitch *) NULL;
+	     i = (i + 1) & p_ctrl->swmask) {
+	    if (sw->offset == offset) {
+		return sw;
+	    }
+	}
+    }
+
+    if (2 * (p_ctrl->nswitches + 1) > p_ctrl->swmask + 1) {
+	/*
+	 * (re)build the table of switch tables at twice the size
+	 */
+	size = (p_ctrl->switches == (StrSwitch **) NULL) ?
+		8 : 2 * (p_ctrl->swmask + 1);
+	tab = ALLOC(StrSwitch*, size);
+	memset(tab, '\0', size * sizeof(StrSwitch*));
+	if (p_ctrl->switches != (StrSwitch **) NULL) {
+	    for (j = 0; j <= p_ctrl->swmask; j++) {
+		sw = p_ctrl->switches[j];
+		if (sw != (StrSwitch *) NULL) {
+		    for (i = SWHASH(sw->offset) & (size - 1);
+			 tab[i] != (StrSwitch *) NULL;
+			 i = (i + 1) & (size - 1)) ;
+		    tab[i] = sw;
+		}
+	    }
+	    FREE(p_ctrl->switches);
+	}
+	p_ctrl->switches = tab;
+	p_ctrl->swmask = size - 1;
+    }
+
+    for (size = 32; size < 2 * (Uint) n && size < 0x10000; size <<= 1) ;
+    sw = ALLOC(StrSwitch, 1);
+    for (i = SWHASH(offset) & p_ctrl->swmask;
+	 p_ctrl->switches[i] != (StrSwitch *) NULL;
+	 i = (i + 1) & p_ctrl->swmask) ;
+    p_ctrl->switches[i] = sw;
+    p_ctrl->nswitches++;
+    sw->offset = offset;
+    sw->mask = size - 1;
+    sw->table = ALLOC(unsigned short, 2 * size);
+    memset(sw->table, '\0', 2 * size * sizeof(unsigned short));
+
+    for (m = 0; m < n; m++) {
+	p = pc + 5 * m;
+	u = FETCH1U(p);
+	str = p_ctrl->strconst(u, FETCH2U(p, u2));
+	hash = Hashtab::hashmem(str->text, str->len);
+	for (i = hash & sw->mask; sw->table[2 * i + 1] != 0;
+	     i = (i + 1) & sw->mask) ;
+	sw->table[2 * i] = hash;
+	sw->table[2 * i + 1] = m + 1;
+    }
+
+    return sw;
+}
+
 /*
  * handle a string switch
  */
@@ -1620,6 +1785,27 @@ unsigned short Frame::switchStr(char *pc)
 
     l = 0;
     --h;
+    if (h >= SWITCH_HASHED) {
+	StrSwitch *sw;
+	String *str;
+	unsigned short hash, i;
+
+	/* look up the string in the hash table */
+	sw = strSwitch(pc, h);
+	hash = Hashtab::hashmem(sp->string->text, sp->string->len);
+	for (i = hash & sw->mask; (m = sw->table[2 * i + 1]) != 0;
+	     i = (i + 1) & sw->mask) {
+	    if (sw->table[2 * i] == hash) {
+		p = pc + 5 * (m - 1);
+		u = FETCH1U(p);
+		str = p_ctrl->strconst(u, FETCH2U(p, u2));
+		if (sp->string->cmp(str) == 0) {
+		    return FETCH2U(p, l);
+		}
+	    }
+	}
+	return dflt;
+    }
     while (l < h) {
 	m = (l + h) >> 1;
 	p = pc + 5 * m;
@@ -1678,17 +1864,22 @@ void Frame::vfunc(int n, int nargs)
 }
 
 /*
- * Main interpreter function. Interpret stack machine code.
+ * Main interpreter function. Interpret stack machine code, until the
+ * code returns, or a local function call is made; in the latter case,
+ * return the frame of the called function.
  */
-void Frame::interpret(char *pc)
+Frame *Frame::interpret(char *pc)
 {
-    unsigned short instr, u, u2;
+    unsigned short instr, u, u2, u3;
     Uint l;
     char *p;
     KFun *kf;
-    int size, instance;
+    Frame *f;
+    int size, instance, cond;
+    unsigned short blocks;
     bool atomic;
-    Value val;
+    Value val, *var;
+    Float flt1, flt2;
 
     size = 0;
     l = 0;
@@ -1737,7 +1928,15 @@ void Frame::interpret(char *pc)
 
 	case I_PUSH_LOCAL:
 	    u = FETCH1S(pc);
-	    pushValue(((short) u < 0) ? fp + (short) u : argp + u);
+	    var = ((short) u < 0) ? fp + (short) u : argp + u;
+	    if (var == argp && vargs) {
+		varargs();
+	    }
+	    if (T_ARITHMETIC(var->type)) {
+		*--sp = *var;	/* no reference to add */
+	    } else {
+		pushValue(var);
+	    }
 	    continue;
 
 	case I_PUSH_GLOBAL:
@@ -1812,7 +2011,15 @@ void Frame::interpret(char *pc)
 	case I_STORE_LOCAL:
 	case I_STORE_LOCAL | I_POP_BIT:
 	    u = FETCH1U(pc);
-	    if (SCHAR(u) >= 0) {
+	    var = (SCHAR(u) >= 0) ? argp + u : fp + SCHAR(u);
+	    if (T_ARITHMETIC(var->type) && T_ARITHMETIC(sp->type)) {
+		/* no references to update */
+		*var = *sp;
+		var->modified = TRUE;
+		if (var == argp) {
+		    vargs = FALSE;
+		}
+	    } else if (SCHAR(u) >= 0) {
 		storeParam(u, sp);
 	    } else {
 		storeLocal(-SCHAR(u), sp);
@@ -1915,18 +2122,191 @@ void Frame::interpret(char *pc)
 	case I_CALL_KFUNC:
 	case I_CALL_KFUNC | I_POP_BIT:
 	    u = FETCH1U(pc);
-	    kf = &KFUN(u);
-	    if (PROTO_VARGS(kf->proto) != 0) {
-		/* variable # of arguments */
-		u2 = FETCH1U(pc) + size;
-		size = 0;
-	    } else {
-		/* fixed # of arguments */
-		u2 = PROTO_NARGS(kf->proto);
-	    }
 	    this->pc = pc;
-	    kfunc(u, u2);
-	    pc = this->pc;
+	    cond = -1;
+	    switch (u) {
+	    /*
+	     * typed operators are executed directly on the stack
+	     */
+	    case KF_ADD_INT:
+		PUT_INT(&sp[1], sp[1].number + sp->number);
+		sp++;
+		break;
+
+	    case KF_ADD1_INT:
+		PUT_INT(sp, sp->number + 1);
+		break;
+
+	    case KF_AND_INT:
+		PUT_INT(&sp[1], sp[1].number & sp->number);
+		sp++;
+		break;
+
+	    case KF_MULT_INT:
+		PUT_INT(&sp[1], sp[1].number * sp->number);
+		sp++;
+		break;
+
+	    case KF_NEG_INT:
+		PUT_INT(sp, ~sp->number);
+		break;
+
+	    case KF_NOT_INT:
+		PUT_INT(sp, !sp->number);
+		break;
+
+	    case KF_OR_INT:
+		PUT_INT(&sp[1], sp[1].number | sp->number);
+		sp++;
+		break;
+
+	    case KF_SUB_INT:
+		PUT_INT(&sp[1], sp[1].number - sp->number);
+		sp++;
+		break;
+
+	    case KF_SUB1_INT:
+		PUT_INT(sp, sp->number - 1);
+		break;
+
+	    case KF_TST_INT:
+		PUT_INT(sp, (sp->number != 0));
+		break;
+
+	    case KF_UMIN_INT:
+		PUT_INT(sp, -sp->number);
+		break;
+
+	    case KF_XOR_INT:
+		PUT_INT(&sp[1], sp[1].number ^ sp->number);
+		sp++;
+		break;
+
+	    case KF_EQ_INT:
+		cond = (sp[1].number == sp->number);
+		break;
+
+	    case KF_GE_INT:
+		cond = (sp[1].number >= sp->number);
+		break;
+
+	    case KF_GT_INT:
+		cond = (sp[1].number > sp->number);
+		break;
+
+	    case KF_LE_INT:
+		cond = (sp[1].number <= sp->number);
+		break;
+
+	    case KF_LT_INT:
+		cond = (sp[1].number < sp->number);
+		break;
+
+	    case KF_NE_INT:
+		cond = (sp[1].number != sp->number);
+		break;
+
+	    case KF_ADD_FLT:
+	    case KF_SUB_FLT:
+	    case KF_MULT_FLT:
+	    case KF_DIV_FLT:
+		i_add_ticks(this, 1);
+		GET_FLT(sp, flt2);
+		GET_FLT(&sp[1], flt1);
+		switch (u) {
+		case KF_ADD_FLT:
+		    flt1.add(flt2);
+		    break;
+
+		case KF_SUB_FLT:
+		    flt1.sub(flt2);
+		    break;
+
+		case KF_MULT_FLT:
+		    flt1.mult(flt2);
+		    break;
+
+		case KF_DIV_FLT:
+		    flt1.div(flt2);
+		    break;
+		}
+		PUT_FLT(&sp[1], flt1);
+		sp++;
+		break;
+
+	    case KF_EQ_FLT:
+	    case KF_GE_FLT:
+	    case KF_GT_FLT:
+	    case KF_LE_FLT:
+	    case KF_LT_FLT:
+	    case KF_NE_FLT:
+		i_add_ticks(this, 1);
+		GET_FLT(sp, flt2);
+		GET_FLT(&sp[1], flt1);
+		cond = flt1.cmp(flt2);
+		switch (u) {
+		case KF_EQ_FLT:
+		    cond = (cond == 0);
+		    break;
+
+		case KF_GE_FLT:
+		    cond = (cond >= 0);
+		    break;
+
+		case KF_GT_FLT:
+		    cond = (cond > 0);
+		    break;
+
+		case KF_LE_FLT:
+		    cond = (cond <= 0);
+		    break;
+
+		case KF_LT_FLT:
+		    cond = (cond < 0);
+		    break;
+
+		case KF_NE_FLT:
+		    cond = (cond != 0);
+		    break;
+		}
+		break;
+
+	    default:
+		kf = &KFUN(u);
+		if (PROTO_VARGS(kf->proto) != 0) {
+		    /* variable # of arguments */
+		    u2 = FETCH1U(pc) + size;
+		    size = 0;
+		} else {
+		    /* fixed # of arguments */
+		    u2 = PROTO_NARGS(kf->proto);
+		}
+		this->pc = pc;
+		kfunc(u, u2);
+		pc = this->pc;
+		break;
+	    }
+
+	    if (cond >= 0) {
+		sp++;
+		if (!(instr & I_POP_BIT) &&
+		    ((UCHAR(*pc) & I_INSTR_MASK) == I_JUMP_ZERO ||
+		     (UCHAR(*pc) & I_INSTR_MASK) == I_JUMP_NONZERO)) {
+		    /* compare and branch */
+		    instr = FETCH1U(pc);
+		    this->pc = pc;
+		    p = prog + FETCH2U(pc, u);
+		    if (((instr & I_INSTR_MASK) == I_JUMP_ZERO) ? !cond : cond) {
+			if (p < pc) {
+			    loop_ticks(this);
+			}
+			pc = p;
+		    }
+		    sp++;
+		    continue;
+		}
+		PUT_INTVAL(sp, cond);
+	    }
 	    break;
 
 	case I_CALL_EFUNC:
@@ -1969,34 +2349,61 @@ void Frame::interpret(char *pc)
 	case I_CALL_AFUNC:
 	case I_CALL_AFUNC | I_POP_BIT:
 	    u = FETCH1U(pc);
-	    funcall((Object *) NULL, (Array *) NULL, 0, u, FETCH1U(pc) + size);
+	    u2 = FETCH1U(pc) + size;
+	    this->pc = pc;
+	    if (!(instr & I_POP_BIT) && heap && tailPosition(pc, &u3)) {
+		return tailCall(0, u, u2, u3);
+	    }
+	    f = trampoline(0, u, u2, instr & I_POP_BIT, 0);
+	    if (f != (Frame *) NULL) {
+		return f;
+	    }
 	    size = 0;
-	    break;
+	    continue;
 
 	case I_CALL_DFUNC:
 	case I_CALL_DFUNC | I_POP_BIT:
 	    u = FETCH1U(pc);
+	    u = UCHAR(ctrl->imap[p_index + u]);
 	    u2 = FETCH1U(pc);
-	    funcall((Object *) NULL, (Array *) NULL,
-		    UCHAR(ctrl->imap[p_index + u]), u2, FETCH1U(pc) + size);
+	    l = FETCH1U(pc) + size;
+	    this->pc = pc;
+	    if (!(instr & I_POP_BIT) && heap && tailPosition(pc, &u3)) {
+		return tailCall(u, u2, l, u3);
+	    }
+	    f = trampoline(u, u2, l, instr & I_POP_BIT, 0);
+	    if (f != (Frame *) NULL) {
+		return f;
+	    }
 	    size = 0;
-	    break;
+	    continue;
 
 	case I_CALL_FUNC:
 	case I_CALL_FUNC | I_POP_BIT:
 	    FETCH2U(pc, u);
-	    vfunc(u, FETCH1U(pc) + size);
+	    p = &ctrl->funcalls[2L * (foffset + u)];
+	    u2 = FETCH1U(pc) + size;
+	    this->pc = pc;
+	    if (!(instr & I_POP_BIT) && heap && tailPosition(pc, &u3)) {
+		return tailCall(UCHAR(p[0]), UCHAR(p[1]), u2, u3);
+	    }
+	    f = trampoline(UCHAR(p[0]), UCHAR(p[1]), u2, instr & I_POP_BIT,
+			   0);
+	    if (f != (Frame *) NULL) {
+		return f;
+	    }
 	    size = 0;
-	    break;
+	    continue;
 
 	case I_CATCH:
 	case I_CATCH | I_POP_BIT:
 	    atomic = this->atomic;
+	    blocks = this->blocks++;
 	    p = prog + FETCH2U(pc, u);
 	    try {
 		ErrorContext::push((ErrorContext::Handler) runtimeError);
 		this->atomic = FALSE;
-		interpret(pc);
+		execute(pc);
 		ErrorContext::pop();
 		pc = this->pc;
 		*--sp = Value::nil;
@@ -2010,17 +2417,20 @@ void Frame::interpret(char *pc)
 		PUSH_STRVAL(this, ErrorContext::exception());
 	    }
 	    this->atomic = atomic;
+	    this->blocks = blocks;
 	    break;
 
 	case I_RLIMITS:
 	    rlimits(FETCH1U(pc));
-	    interpret(pc);
+	    this->blocks++;
+	    execute(pc);
+	    --this->blocks;
 	    pc = this->pc;
 	    setRlimits(rlim->next);
 	    continue;
 
 	case I_RETURN:
-	    return;
+	    return (Frame *) NULL;
 
 # ifdef DEBUG
 	default:
@@ -2036,86 +2446,93 @@ void Frame::interpret(char *pc)
 }
 
 /*
- * Call a function in an object. The arguments must be on the stack already.
+ * Set up a new frame for a function call. The arguments must be on the
+ * stack already. Returns the program counter at the local stack size.
  */
-void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
-		    int nargs)
+char *Frame::enter(Frame *f, Object *obj, Array *lwobj, int p_ctrli,
+		   int funci, int nargs)
 {
     char *pc;
     unsigned short n;
-    Frame f;
     bool ellipsis;
-    Value val;
 
-    f.prev = this;
+    if (psample) {
+	sample();
+    }
+
+    f->prev = this;
     if (oindex == OBJ_NONE) {
 	/*
 	 * top level call
 	 */
-	f.oindex = obj->index;
-	f.lwobj = (Array *) NULL;
-	f.ctrl = obj->ctrl;
-	f.data = obj->dataspace();
-	f.external = TRUE;
+	f->oindex = obj->index;
+	f->lwobj = (Array *) NULL;
+	f->ctrl = obj->ctrl;
+	f->data = obj->dataspace();
+	f->external = TRUE;
     } else if (lwobj != (Array *) NULL) {
 	/*
 	 * call_other to lightweight object
 	 */
-	f.oindex = obj->index;
-	f.lwobj = lwobj;
-	f.ctrl = obj->ctrl;
-	f.data = lwobj->primary->data;
-	f.external = TRUE;
+	f->oindex = obj->index;
+	f->lwobj = lwobj;
+	f->ctrl = obj->ctrl;
+	f->data = lwobj->primary->data;
+	f->external = TRUE;
     } else if (obj != (Object *) NULL) {
 	/*
 	 * call_other to persistent object
 	 */
-	f.oindex = obj->index;
-	f.lwobj = (Array *) NULL;
-	f.ctrl = obj->ctrl;
-	f.data = obj->dataspace();
-	f.external = TRUE;
+	f->oindex = obj->index;
+	f->lwobj = (Array *) NULL;
+	f->ctrl = obj->ctrl;
+	f->data = obj->dataspace();
+	f->external = TRUE;
     } else {
 	/*
 	 * local function call
 	 */
-	f.oindex = oindex;
-	f.lwobj = this->lwobj;
-	f.ctrl = ctrl;
-	f.data = data;
-	f.external = FALSE;
-    }
-    f.depth = depth + 1;
-    f.rlim = rlim;
-    if (f.depth >= f.rlim->maxdepth && !f.rlim->nodepth) {
+	f->oindex = oindex;
+	f->lwobj = this->lwobj;
+	f->ctrl = ctrl;
+	f->data = data;
+	f->external = FALSE;
+    }
+    f->depth = depth + 1;
+    f->rlim = rlim;
+    if (f->depth >= f->rlim->maxdepth && !f->rlim->nodepth) {
 	error("Stack overflow");
     }
-    if (f.rlim->ticks < 100) {
-	if (f.rlim->noticks) {
-	    f.rlim->ticks = 0x7fffffff;
+    if (f->rlim->ticks < 100) {
+	if (f->rlim->noticks) {
+	    f->rlim->ticks = 0x7fffffff;
 	} else {
 	    error("Out of ticks");
 	}
     }
-    f.kflv = FALSE;
+    f->kflv = FALSE;
+    f->heap = FALSE;
+    f->blocks = 0;
+    f->nvargs = 0;
+    f->vargs = FALSE;
 
     /* set the program control block */
-    obj = OBJR(f.ctrl->inherits[p_ctrli].oindex);
-    f.foffset = f.ctrl->inherits[p_ctrli].funcoffset;
-    f.p_ctrl = obj->control();
-    f.p_index = f.ctrl->inherits[p_ctrli].progoffset;
+    obj = OBJR(f->ctrl->inherits[p_ctrli].oindex);
+    f->foffset = f->ctrl->inherits[p_ctrli].funcoffset;
+    f->p_ctrl = obj->control();
+    f->p_index = f->ctrl->inherits[p_ctrli].progoffset;
 
     /* get the function */
-    f.func = &f.p_ctrl->funcs()[funci];
-    if (f.func->sclass & C_UNDEFINED) {
+    f->func = &f->p_ctrl->funcs()[funci];
+    if (f->func->sclass & C_UNDEFINED) {
 	error("Undefined function %s",
-	      f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+	      f->p_ctrl->strconst(f->func->inherit, f->func->index)->text);
     }
 
-    pc = f.p_ctrl->program() + f.func->offset;
-    if (f.func->sclass & C_TYPECHECKED) {
+    pc = f->p_ctrl->program() + f->func->offset;
+    if (f->func->sclass & C_TYPECHECKED) {
 	/* typecheck arguments */
-	typecheck(&f, f.p_ctrl->strconst(f.func->inherit, f.func->index)->text,
+	typecheck(f, f->p_ctrl->strconst(f->func->inherit, f->func->index)->text,
 		  "function", pc, nargs, FALSE);
     }
 
@@ -2128,7 +2545,7 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
 	/* if fewer actual than formal parameters, check for varargs */
 	if (nargs < PROTO_NARGS(pc) && stricttc) {
 	    error("Insufficient arguments for function %s",
-		  f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+		  f->p_ctrl->strconst(f->func->inherit, f->func->index)->text);
 	}
 
 	/* add missing arguments */
@@ -2164,31 +2581,31 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
 	    nargs++;
 	}
 	if (ellipsis) {
-	    PUSH_ARRVAL(this, Array::create(f.data, 0));
+	    /* empty varargs array, created when used */
+	    *--sp = Value::nil;
+	    f->vargs = TRUE;
 	    nargs++;
 	    if ((FETCH1U(pc) & T_TYPE) == T_CLASS) {
 		pc += 3;
 	    }
 	}
     } else if (ellipsis) {
-	Value *v;
-	Array *a;
-
-	/* put additional arguments in array */
-	nargs -= n - 1;
-	a = Array::create(f.data, nargs);
-	v = a->elts + nargs;
-	do {
-	    *--v = *sp++;
-	} while (--nargs > 0);
-	Dataspace::refImports(a);
-	PUSH_ARRVAL(this, a);
+	/*
+	 * leave additional arguments on the stack, below the argument
+	 * pointer; the array is created when it is used
+	 */
+	growStack(1);
+	f->nvargs = nargs - (n - 1);
+	memmove(sp - 1, sp, f->nvargs * sizeof(Value));
+	sp[f->nvargs - 1] = Value::nil;
+	--sp;
+	f->vargs = TRUE;
 	nargs = n;
 	pc += PROTO_SIZE(pc);
     } else if (nargs > n) {
 	if (stricttc) {
 	    error("Too many arguments for function %s",
-		  f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+		  f->p_ctrl->strconst(f->func->inherit, f->func->index)->text);
 	}
 
 	/* pop superfluous arguments */
@@ -2198,87 +2615,299 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     } else {
 	pc += PROTO_SIZE(pc);
     }
-    f.sp = sp;
-    f.nargs = nargs;
-    cframe = &f;
-    if (f.lwobj != (Array *) NULL) {
-	f.lwobj->ref();
+    f->sp = sp;
+    f->nargs = nargs;
+    cframe = f;
+    if (f->lwobj != (Array *) NULL) {
+	f->lwobj->ref();
     }
 
     /* deal with atomic functions */
-    f.level = level;
-    if ((f.func->sclass & C_ATOMIC) && !atomic) {
+    f->level = level;
+    if ((f->func->sclass & C_ATOMIC) && !atomic) {
 	Object::newPlane();
-	new Dataplane(f.data, ++f.level);
-	f.atomic = TRUE;
-	if (!f.rlim->noticks) {
-	    f.rlim->ticks >>= 1;
+	new Dataplane(f->data, ++f->level);
+	f->atomic = TRUE;
+	if (!f->rlim->noticks) {
+	    f->rlim->ticks >>= 1;
 	}
     } else {
-	if (f.level != f.data->plane->level) {
-	    new Dataplane(f.data, f.level);
+	if (f->level != f->data->plane->level) {
+	    new Dataplane(f->data, f->level);
 	}
-	f.atomic = atomic;
+	f->atomic = atomic;
     }
 
-    i_add_ticks(&f, 10);
+    i_add_ticks(f, 10);
+
+    if (nfstats != 0) {
+	f->stats = funcStats(obj, f->p_ctrl) + 3 * funci;
+	f->stats[0]++;
+	f->sticks = f->rlim->ticks;
+	f->susec = P_utime();
+    } else {
+	f->stats = (Uuint *) NULL;
+    }
+
+    return pc;
+}
+
+/*
+ * initialize the local variables of a new frame, with the local stack
+ * already allocated, and return the program counter at the start of the
+ * code, or NULL if the function was executed by the extension interface
+ */
+char *Frame::start(char *pc, int funci)
+{
+    unsigned short n;
 
     /* create new local stack */
-    f.argp = f.sp;
+    argp = sp + nvargs;
     FETCH2U(pc, n);
-    f.stack = ALLOCA(Value, n + MIN_STACK + EXTRA_STACK);
-    f.fp = f.sp = f.stack + n + MIN_STACK + EXTRA_STACK;
-    f.sos = TRUE;
+    fp = sp = stack + n + MIN_STACK + EXTRA_STACK;
 
     /* initialize local variables */
     n = FETCH1U(pc);
-# ifdef DEBUG
-    nargs = n;
-# endif
     if (n > 0) {
 	do {
-	    *--f.sp = Value::nil;
+	    *--sp = Value::nil;
 	} while (--n > 0);
     }
 
-    f.ctrl->funCalls();	/* make sure they are available */
+    ctrl->funCalls();	/* make sure they are available */
 
     /* execute code */
-    f.source = 0;
-    if (!Ext::execute(&f, funci)) {
-	f.prog = pc += 2;
-	f.interpret(pc);
+    source = 0;
+    if (Ext::execute(this, funci)) {
+	return (char *) NULL;
     }
-    val = *f.sp++;
+    return prog = pc + 2;
+}
+
+/*
+ * clean up a returning frame, and move the return value to this frame
+ */
+void Frame::leave(Frame *f)
+{
+    Value val;
+# ifdef DEBUG
+    char *pc;
+# endif
+
+    val = *f->sp++;
 
     /* clean up stack, move return value to outer stackframe */
 # ifdef DEBUG
-    if (f.sp != f.fp - nargs) {
+    pc = f->p_ctrl->program() + f->func->offset;
+    pc += PROTO_SIZE(pc) + 2;
+    if (f->sp != f->fp - UCHAR(*pc)) {
 	fatal("bad stack pointer after function call");
     }
 # endif
-    f.pop(f.fp - f.sp);
-    if (f.sos) {
-	    /* still alloca'd */
-	AFREE(f.stack);
+    f->pop(f->fp - f->sp);
+    if (f->sos) {
+	/* still alloca'd, or part of the frame */
+	if (!f->heap) {
+	    AFREE(f->stack);
+	}
     } else {
 	/* extended and malloced */
-	FREE(f.stack);
+	FREE(f->stack);
     }
 
-    if (f.lwobj != (Array *) NULL) {
-	f.lwobj->del();
+    if (f->stats != (Uuint *) NULL) {
+	/* inclusive of called functions */
+	if (f->sticks > f->rlim->ticks) {
+	    f->stats[1] += f->sticks - f->rlim->ticks;
+	}
+	f->stats[2] += P_utime() - f->susec;
+    }
+
+    if (f->lwobj != (Array *) NULL) {
+	f->lwobj->del();
     }
     cframe = this;
-    pop(f.nargs);
+    pop(f->nvargs + f->nargs);
     *--sp = val;
 
-    if ((f.func->sclass & C_ATOMIC) && !atomic) {
-	Dataplane::commit(f.level, &val);
+    if ((f->func->sclass & C_ATOMIC) && !atomic) {
+	Dataplane::commit(f->level, &val);
 	Object::commitPlane();
-	if (!f.rlim->noticks) {
-	    f.rlim->ticks *= 2;
+	if (!f->rlim->noticks) {
+	    f->rlim->ticks *= 2;
+	}
+    }
+}
+
+/*
+ * Call a function in an object. The arguments must be on the stack already.
+ */
+void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
+		    int nargs)
+{
+    char *pc;
+    unsigned short n;
+    Frame f;
+
+    pc = enter(&f, obj, lwobj, p_ctrli, funci, nargs);
+    FETCH2U(pc, n);
+    f.stack = ALLOCA(Value, n + MIN_STACK + EXTRA_STACK);
+    f.sos = TRUE;
+    pc = f.start(pc - 2, funci);
+    if (pc != (char *) NULL) {
+	f.execute(pc);
+    }
+    leave(&f);
+}
+
+/*
+ * Set up a frame for a local function call, to be run by the interpreter
+ * loop that is already active.  The frame and its local stack are taken
+ * from the frame pool.  The return value is checked to be of type rtype,
+ * unless 0, and discarded if requested.  Returns NULL if the function was
+ * executed by the extension interface.
+ */
+Frame *Frame::trampoline(int p_ctrli, int funci, int nargs, bool discard,
+			 unsigned short rtype)
+{
+    char *pc;
+    Frame *f;
+
+    /* take the frame and its stack from the pool */
+    if (fptop + FRAMEMAX > fpend) {
+	error("Stack overflow");
+    }
+    f = (Frame *) fptop;
+    fptop += FRAMESZ;	/* claimed before the caller's stack can be extended */
+    try {
+	pc = enter(f, (Object *) NULL, (Array *) NULL, p_ctrli, funci, nargs);
+    } catch (...) {
+	if (fptop > (Value *) f) {
+	    fptop = (Value *) f;
+	}
+	throw;
+    }
+    f->heap = TRUE;
+    f->discard = discard;
+    f->rtype = rtype;
+    f->stack = fptop;
+    f->sos = TRUE;
+    fptop += (UCHAR(pc[0]) << 8) + UCHAR(pc[1]) + MIN_STACK + EXTRA_STACK;
+    f->pc = f->start(pc, funci);
+    if (f->pc == (char *) NULL) {
+	leave(f);
+	release(f);
+	if (rtype != 0) {
+	    cast(sp, rtype, 0);
+	}
+	if (discard) {
+	    (sp++)->del();
 	}
+	return (Frame *) NULL;
+    }
+    return f;
+}
+
+/*
+ * check if a call is in tail position: directly followed by a return,
+ * possibly with a cast to a simple type in between, in a function that
+ * was called locally and is not atomic, outside catch and rlimits blocks
+ */
+bool Frame::tailPosition(char *pc, unsigned short *rtype)
+{
+    if (blocks != 0 || (func->sclass & C_ATOMIC)) {
+	return FALSE;
+    }
+
+    *rtype = this->rtype;
+    if ((UCHAR(*pc) & I_INSTR_MASK) == I_CAST) {
+	if (UCHAR(pc[1]) == T_CLASS ||
+	    (*rtype != 0 && *rtype != UCHAR(pc[1]))) {
+	    return FALSE;
+	}
+	*rtype = UCHAR(pc[1]);
+	pc += 2;
+    }
+    return ((UCHAR(*pc) & I_INSTR_MASK) == I_RETURN);
+}
+
+/*
+ * Replace this frame, set up by trampoline(), with the frame of a local
+ * function call in tail position.  Returns the new frame, or the previous
+ * frame if the function was executed by the extension interface.
+ */
+Frame *Frame::tailCall(int p_ctrli, int funci, int nargs,
+		       unsigned short rtype)
+{
+    Frame *f, *next;
+    Value *args;
+    bool discard;
+
+    f = prev;
+    discard = this->discard;
+
+    /* take the arguments, and return nil instead */
+    args = ALLOCA(Value, nargs);
+    memcpy(args, sp, nargs * sizeof(Value));
+    sp += nargs;
+    *--sp = Value::nil;
+    f->leave(this);
+    release(this);
+
+    /* make the call from the previous frame */
+    f->sp++;
+    f->growStack(nargs);
+    f->sp -= nargs;
+    memcpy(f->sp, args, nargs * sizeof(Value));
+    AFREE(args);
+    next = f->trampoline(p_ctrli, funci, nargs, discard, rtype);
+
+    return (next != (Frame *) NULL) ? next : f;
+}
+
+/*
+ * deallocate a frame set up by trampoline()
+ */
+void Frame::release(Frame *f)
+{
+# ifdef DEBUG
+    if ((Value *) f < fpool || (Value *) f > fptop) {
+	fatal("frame released out of order");
+    }
+# endif
+    fptop = (Value *) f;
+}
+
+/*
+ * Run the code of this frame until it returns.  Local function calls are
+ * made in the same loop, without recursion.
+ */
+void Frame::execute(char *pc)
+{
+    Frame *f, *next;
+
+    f = this;
+    for (;;) {
+	next = f->interpret(pc);
+	if (next != (Frame *) NULL) {
+	    /* function call */
+	    f = next;
+	} else if (f != this) {
+	    /* function return */
+	    next = f;
+	    f = f->prev;
+	    f->leave(next);
+	    if (next->rtype != 0) {
+		f->cast(f->sp, next->rtype, 0);
+	    }
+	    if (next->discard) {
+		(f->sp++)->del();
+	    }
+	    release(next);
+	} else {
+	    return;
+	}
+	pc = f->pc;
     }
 }
 
@@ -2559,6 +3188,9 @@ Array *Frame::funcTrace(Dataspace *data)
 
     max_args = Config::arraySize() - 5;
 
+    if (vargs) {
+	varargs();
+    }
     n = nargs;
     args = argp + n;
     if (n > max_args) {
@@ -2652,6 +3284,207 @@ Array *Frame::callTrace()
     return a;
 }
 
+/*
+ * return the statistics of the functions in a program, discarding
+ * those of a previous program with the same index
+ */
+Uuint *Frame::funcStats(Object *obj, Control *ctrl)
+{
+    FuncStats *fs;
+    Uint size;
+
+    fs = &fstats[obj->index];
+    if (fs->stats == (Uuint *) NULL || fs->count != obj->count ||
+	fs->compiled != ctrl->compiled || fs->nfuncdefs != ctrl->nfuncdefs) {
+	Alloc::staticMode();
+	if (fs->stats != (Uuint *) NULL) {
+	    FREE(fs->stats);
+	}
+	/* keep the number of different static chunk sizes low */
+	for (size = 8; size < 3 * ctrl->nfuncdefs; size <<= 1) ;
+	fs->stats = ALLOC(Uuint, size);
+	Alloc::dynamicMode();
+	memset(fs->stats, '\0', size * sizeof(Uuint));
+	fs->count = obj->count;
+	fs->compiled = ctrl->compiled;
+	fs->nfuncdefs = ctrl->nfuncdefs;
+    }
+    return fs->stats;
+}
+
+/*
+ * return a mapping of function name : ({ calls, ticks, usec }) for the
+ * functions defined in a program, or NULL if statistics are disabled
+ */
+Array *Frame::funcStats(Dataspace *data, Object *obj, Control *ctrl)
+{
+    FuncStats *fs;
+    FuncDef *f;
+    Uuint *stats;
+    unsigned short i, n;
+    Value *v;
+    Array *m, *a;
+
+    if (nfstats == 0) {
+	return (Array *) NULL;
+    }
+    fs = &fstats[obj->index];
+    if (fs->stats == (Uuint *) NULL ||
+	fs->count != obj->count || fs->compiled != ctrl->compiled ||
+	fs->nfuncdefs != ctrl->nfuncdefs) {
+	return Array::mapCreate(data, 0);
+    }
+
+    /* only functions that were called */
+    for (i = n = 0, stats = fs->stats; i < ctrl->nfuncdefs; i++, stats += 3) {
+	if (stats[0] != 0) {
+	    n++;
+	}
+    }
+    i_add_ticks(cframe, 3 * n);
+
+    m = Array::mapCreate(data, 2L * n);
+    try {
+	ErrorContext::push();
+	memset(m->elts, '\0', 2L * n * sizeof(Value));
+	v = m->elts;
+	for (i = 0, f = ctrl->funcs(), stats = fs->stats; i < ctrl->nfuncdefs;
+	     i++, f++, stats += 3) {
+	    if (stats[0] != 0) {
+		PUT_STRVAL(v, ctrl->strconst(f->inherit, f->index));
+		a = Array::create(data, 3);
+		Config::putval(&a->elts[0], stats[0]);
+		Config::putval(&a->elts[1], stats[1]);
+		Config::putval(&a->elts[2], stats[2]);
+		PUT_ARRVAL(v + 1, a);
+		v += 2;
+	    }
+	}
+	ErrorContext::pop();
+    } catch (...) {
+	/* discard mapping */
+	m->ref();
+	m->del();
+	error((char *) NULL);
+    }
+
+    m->mapSort();
+    return m;
+}
+
+/*
+ * record the current call chain in the profile
+ */
+void Frame::sample()
+{
+    char buffer[PROFSTACKSZ], line[12];
+    char *p;
+    const char *prog;
+    Frame *f;
+    String *str;
+    ProfStack **h, *ps;
+    unsigned int len, size;
+
+    psample = FALSE;
+
+    /* folded stack, outermost function first */
+    p = buffer + PROFSTACKSZ;
+    *--p = '\0';
+    for (f = this; f->oindex != OBJ_NONE; f = f->prev) {
+	prog = OBJR(f->p_ctrl->oindex)->name;
+	str = f->p_ctrl->strconst(f->func->inherit, f->func->index);
+	sprintf(line, ":%u", (f->source != 0) ? f->source : f->line());
+	len = strlen(prog) + str->len + strlen(line) + 2;
+	if (p - buffer < len + 1) {
+	    break;	/* truncated */
+	}
+	if (f != this) {
+	    *--p = ';';
+	}
+	p -= len;
+	sprintf(p, "/%s:%s%s", prog, str->text, line);
+	p[len] = (f != this) ? ';' : '\0';
+    }
+    if (*p == '\0') {
+	return;
+    }
+
+    Alloc::staticMode();
+    if (ptab == (Hashtab *) NULL) {
+	ptab = Hashtab::create(PROFHASHSZ, PROFSTACKSZ, FALSE);
+    }
+    h = (ProfStack **) ptab->lookup(p, TRUE);
+    if (*h == (ProfStack *) NULL) {
+	if (pstacks >= PROFSTACKS) {
+	    /* too many different stacks */
+	    p = (char *) "[other]";
+	    h = (ProfStack **) ptab->lookup(p, TRUE);
+	}
+	if (*h == (ProfStack *) NULL) {
+	    /* keep the number of different static chunk sizes low */
+	    len = strlen(p) + 1;
+	    for (size = STRINGSZ; size < len; size <<= 1) ;
+	    ps = ALLOC(ProfStack, 1);
+	    ps->next = (Hashtab::Entry *) NULL;
+	    ps->name = strcpy(ALLOC(char, size), p);
+	    ps->count = 0;
+	    *h = ps;
+	    pstacks++;
+	}
+    }
+    (*h)->count++;
+    Alloc::dynamicMode();
+}
+
+/*
+ * remove profiled stacks, and return them in folded format
+ */
+Array *Frame::profile()
+{
+    char buffer[12];
+    Hashtab::Entry **t, **e;
+    ProfStack *ps;
+    Uint n, size;
+    Value *v;
+    String *str;
+    Array *a;
+
+    n = pstacks;
+    if (n > Config::arraySize()) {
+	n = Config::arraySize();
+    }
+    a = Array::create(data, n);
+    if (n == 0) {
+	return a;
+    }
+    i_add_ticks(this, 10 * n);
+
+    v = a->elts;
+    t = ptab->table();
+    for (size = ptab->size(); size != 0; --size, t++) {
+	for (e = t; *e != (Hashtab::Entry *) NULL; ) {
+	    ps = (ProfStack *) *e;
+	    *e = ps->next;
+
+	    sprintf(buffer, " %lu", (unsigned long) ps->count);
+	    str = String::create((char *) NULL, strlen(ps->name) +
+					       strlen(buffer));
+	    strcpy(str->text, ps->name);
+	    strcat(str->text, buffer);
+	    PUT_STRVAL(v, str);
+	    v++;
+	    FREE((char *) ps->name);
+	    FREE(ps);
+	    --pstacks;
+
+	    if (--n == 0) {
+		return a;
+	    }
+	}
+    }
+    return a;
+}
+
 /*
  * fake error handler
  */
@@ -2743,8 +3576,9 @@ Frame *Frame::restore(Int level)
     if (!f->rlim->noticks) {
 	f->rlim->ticks *= 2;
     }
-    setSp(f->sp);
-    Dataplane::discard(this->level);
+    level = this->level;
+    setSp(f->sp);	/* this frame may be deallocated */
+    Dataplane::discard(level);
     Object::discardPlane();
 
     return f;
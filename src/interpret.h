@@ -202,6 +202,7 @@ public:
     unsigned short storesSpread(int n, int offset, int type, Uint sclass);
     void toFloat(class Float *flt);
     Int toInt();
+    void varargs();
     void kfunc(int n, int nargs);
     void vfunc(int n, int nargs);
     void rlimits(bool privileged);
@@ -210,12 +211,15 @@ public:
 	      int call_static, int nargs);
     bool callTraceI(Int idx, Value *v);
     Array *callTrace();
+    Array *profile();
+    void sample();
     bool callCritical(const char *func, int narg, int flag);
     void atomicError(Int level);
     Frame *restore(Int level);
 
-    static void init(char *create, bool flag);
+    static void init(char *create, bool flag, uindex stats);
     static int instanceOf(unsigned int oindex, char *prog);
+    static Array *funcStats(Dataspace *data, Object *obj, Control *ctrl);
     static Int div(Int num, Int denom);
     static Int lshift(Int num, Int shift);
     static Int mod(Int num, Int denom);
@@ -243,6 +247,7 @@ public:
     unsigned short source;	/* source code line number */
     bool atomic;		/* within uncaught atomic code */
     bool kflv;			/* kfun with lvalue parameters */
+    bool vargs;			/* varargs array not yet created */
 
 private:
     void string(int inherit, unsigned int index);
@@ -259,14 +264,33 @@ private:
     unsigned short switchInt(char *pc);
     unsigned short switchRange(char *pc);
     unsigned short switchStr(char *pc);
-    void interpret(char *pc);
+    struct StrSwitch *strSwitch(char *pc, unsigned short n);
+    char *enter(Frame *f, Object *obj, Array *lwobj, int p_ctrli, int funci,
+		int nargs);
+    char *start(char *pc, int funci);
+    void leave(Frame *f);
+    Frame *trampoline(int p_ctrli, int funci, int nargs, bool discard,
+		      unsigned short rtype);
+    bool tailPosition(char *pc, unsigned short *rtype);
+    Frame *tailCall(int p_ctrli, int funci, int nargs, unsigned short rtype);
+    static void release(Frame *f);
+    void execute(char *pc);
+    Frame *interpret(char *pc);
     unsigned short line();
     Array *funcTrace(Dataspace *data);
 
-    static int instanceOf(unsigned int oindex, char *prog, Uint hash);
+    static Uuint *funcStats(Object *obj, Control *ctrl);
 
     unsigned short nargs;	/* # arguments */
+    unsigned short nvargs;	/* # variable arguments below argp */
     bool sos;			/* stack on stack */
+    bool heap;			/* frame set up by trampoline() */
+    bool discard;		/* discard return value */
+    unsigned short rtype;	/* type of return value to check */
+    unsigned short blocks;	/* # active catch and rlimits blocks */
+    Uuint *stats;		/* function statistics */
+    Int sticks;			/* ticks left at function start */
+    Uuint susec;		/* time at function start */
     uindex foffset;		/* program function offset */
     char *prog;			/* start of program */
     Value *stack;		/* local value stack */
@@ -284,4 +308,7 @@ extern Frame *cframe;
 		error("Out of ticks");					\
 	    }								\
 	}								\
+	if (psample) {							\
+	    (f)->sample();						\
+	}								\
     } while (FALSE)
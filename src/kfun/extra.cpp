@@ -20,6 +20,7 @@
 # ifndef FUNCDEF
 # define INCLUDE_CTYPE
 # include "kfun.h"
+# include "hash.h"
 # include "parse.h"
 # include "asn.h"
 # endif
@@ -30,6 +31,7 @@ FUNCDEF("encrypt", kf_encrypt, pt_encrypt, 0)
 extern String *P_encrypt_des_key (Frame*, String*);
 extern String *P_encrypt_des (Frame*, String*, String*);
 extern void ext_runtime_error (Frame*, const char*);
+extern void ext_runtime_check (Frame*, int);
 
 char pt_encrypt[] = { C_TYPECHECKED | C_STATIC, 2, 1, 0, 9, T_MIXED, T_STRING,
 		      T_STRING, T_STRING };
@@ -181,7 +183,7 @@ char pt_explode[] = { C_TYPECHECKED | C_STATIC, 2, 0, 0, 8,
 int kf_explode(Frame *f, int n, KFun *kf)
 {
     unsigned int len, slen, size;
-    char *p, *s;
+    char *p, *q, *s;
     Value *v;
     Array *a;
 
@@ -217,17 +219,12 @@ int kf_explode(Frame *f, int n, KFun *kf)
 	    p += slen;
 	    len -= slen;
 	}
-	while (len > slen) {
-	    if (memcmp(p, s, slen) == 0) {
-		/* separator found */
-		p += slen;
-		len -= slen;
-		size++;
-	    } else {
-		/* next char */
-		p++;
-		--len;
-	    }
+	while (len > slen &&
+	       (q = String::find(p, len - 1, s, slen)) != (char *) NULL) {
+	    /* separator found, not at the end */
+	    len -= q + slen - p;
+	    p = q + slen;
+	    size++;
 	}
 
 	a = Array::create(f->data, size);
@@ -235,34 +232,24 @@ int kf_explode(Frame *f, int n, KFun *kf)
 
 	p = f->sp[1].string->text;
 	len = f->sp[1].string->len;
-	size = 0;
 	if (len > slen && memcmp(p, s, slen) == 0) {
 	    /* skip leading separator */
 	    p += slen;
 	    len -= slen;
 	}
-	while (len > slen) {
-	    if (memcmp(p, s, slen) == 0) {
-		/* separator found */
-		PUT_STRVAL(v, String::create(p - size, size));
-		v++;
-		p += slen;
-		len -= slen;
-		size = 0;
-	    } else {
-		/* next char */
-		p++;
-		--len;
-		size++;
-	    }
+	while (len > slen &&
+	       (q = String::find(p, len - 1, s, slen)) != (char *) NULL) {
+	    PUT_STRVAL(v, String::create(p, q - p));
+	    v++;
+	    len -= q + slen - p;
+	    p = q + slen;
 	}
-	if (len != slen || memcmp(p, s, slen) != 0) {
-	    /* remainder isn't a sepatator */
-	    size += len;
-	    p += len;
+	if (len >= slen && memcmp(p + len - slen, s, slen) == 0) {
+	    /* skip trailing separator */
+	    len -= slen;
 	}
 	/* final array element */
-	PUT_STRVAL(v, String::create(p - size, size));
+	PUT_STRVAL(v, String::create(p, len));
     }
 
     (f->sp++)->string->del();
@@ -368,55 +355,206 @@ FUNCDEF("sscanf", kf_sscanf, pt_sscanf, 2)
 char pt_sscanf[] = { C_STATIC | C_ELLIPSIS, 2, 1, 0, 9, T_INT, T_STRING,
 		     T_STRING, T_LVALUE };
 
+struct ScanOp {
+    char type;			/* 's', 'd', 'f', 'c', '\0' at end or '?' if bad */
+    char until;			/* %s followed by 'd', 'f', literal 'l' or '\0' */
+    bool skip;			/* %*: no assignment */
+    unsigned int lit;		/* offset of preceding literal text */
+    unsigned int llen;		/* length of preceding literal text */
+};
+
+struct ScanFormat {
+    ScanFormat *next;		/* next in hash chain */
+    ScanFormat *older;		/* next in LRU list */
+    ScanFormat *newer;		/* previous in LRU list */
+    unsigned short hash;	/* hash value of format */
+    unsigned int flen;		/* length of format */
+    char *format;		/* format */
+    char *lits;			/* literal text, with %% replaced by % */
+    ScanOp *ops;		/* conversions, ending with '\0' */
+};
+
+static ScanFormat sfentries[SCANFCACHESZ];	/* compiled formats */
+static ScanFormat *sftab[SCANFCACHESZ];		/* hash table */
+static ScanFormat *sfnewest, *sfoldest;		/* LRU list */
+static unsigned int nsformats;			/* # compiled formats */
+
 /*
- * match a string possibly including %%, up to the next %[sdfc] or
- * the end of the string
+ * compile a sscanf format into a list of conversions, each preceded by
+ * literal text.  Return the number of conversions
  */
-static bool match(char *f, char *s, unsigned int *flenp, unsigned int *slenp)
+static unsigned int scanCompile(const char *format, unsigned int flen,
+				ScanOp *ops, char *lits)
 {
-    char *p;
-    unsigned int flen, slen;
-
-    flen = *flenp;
-    slen = *slenp;
-
-    while (flen > 0) {
-	/* look for first % */
-	p = (char *) memchr(f, '%', flen);
-
-	if (p == (char *) NULL) {
-	    /* no remaining % */
-	    if (memcmp(f, s, flen) == 0) {
-		*slenp -= slen - flen;
-		return TRUE;
-	    } else {
-		return FALSE;	/* no match */
+    ScanOp *op;
+    unsigned int l;
+    char c;
+
+    op = ops;
+    l = 0;
+    for (;;) {
+	/* literal text */
+	op->lit = l;
+	while (flen != 0 && (format[0] != '%' || format[1] == '%')) {
+	    if (format[0] == '%') {
+		format++;
+		--flen;
+	    }
+	    lits[l++] = *format++;
+	    --flen;
+	}
+	op->llen = l - op->lit;
+	op->until = '\0';
+	op->skip = FALSE;
+	if (flen == 0) {
+	    op->type = '\0';
+	    return op - ops + 1;
+	}
+
+	/* conversion */
+	format++;
+	--flen;
+	if (*format == '*') {
+	    format++;
+	    --flen;
+	    op->skip = TRUE;
+	}
+	switch (op->type = *format) {
+	case 's':
+	    format++;
+	    --flen;
+	    if (format[0] == '%' && format[1] != '%') {
+		c = (format[1] == '*') ? format[2] : format[1];
+		if (c != 'd' && c != 'f') {
+		    op->type = '?';
+		    return op - ops + 1;
+		}
+		op->until = c;
+	    } else if (flen != 0) {
+		op->until = 'l';
 	    }
+	    break;
+
+	case 'd':
+	case 'f':
+	case 'c':
+	    format++;
+	    --flen;
+	    break;
+
+	default:
+	    op->type = '?';
+	    return op - ops + 1;
 	}
+	op++;
+    }
+}
+
+/*
+ * find a compiled sscanf format, or compile it.  Recently used formats are
+ * kept in a cache; a format that is too long to be cached must be freed
+ * by the caller
+ */
+static ScanFormat *scanFormat(char *format, unsigned int flen)
+{
+    ScanFormat **h, *sf;
+    unsigned short hash;
+    ScanOp *ops;
+    char *lits;
+    unsigned int nops;
+
+    if (flen > SCANFMAXLEN) {
+	sf = ALLOC(ScanFormat, 1);
+	sf->ops = ALLOC(ScanOp, flen / 2 + 1);
+	sf->lits = ALLOC(char, flen + 1);
+	sf->format = (char *) NULL;
+	scanCompile(format, flen, sf->ops, sf->lits);
+	return sf;
+    }
 
-	if (p[1] == '%') {
-	    /* %% */
-	    if (memcmp(f, s, ++p - f) == 0) {
-		/* matched up to and including the first % */
-		s += p - f;
-		slen -= p - f;
-		flen -= ++p - f;
-		f = p;
-	    } else {
-		return FALSE;	/* no match */
+    hash = Hashtab::hashmem(format, (flen < SCANFHASHSZ) ? flen : SCANFHASHSZ) ^
+	   flen;
+    for (h = &sftab[hash % SCANFCACHESZ]; *h != (ScanFormat *) NULL;
+	 h = &(*h)->next) {
+	sf = *h;
+	if (sf->hash == hash && sf->flen == flen &&
+	    memcmp(sf->format, format, flen) == 0) {
+	    if (sf != sfnewest) {
+		/* move to the front of the LRU list */
+		sf->newer->older = sf->older;
+		if (sf->older != (ScanFormat *) NULL) {
+		    sf->older->newer = sf->newer;
+		} else {
+		    sfoldest = sf->newer;
+		}
+		sf->newer = (ScanFormat *) NULL;
+		sf->older = sfnewest;
+		sfnewest->newer = sf;
+		sfnewest = sf;
 	    }
-	} else if (memcmp(f, s, p - f) == 0) {
-	    /* matched up to the first % */
-	    *flenp -= flen - (p - f);
-	    *slenp -= slen - (p - f);
-	    return TRUE;
+	    return sf;
+	}
+    }
+
+    /* compile */
+    ops = ALLOCA(ScanOp, flen / 2 + 1);
+    lits = ALLOCA(char, flen + 1);
+    nops = scanCompile(format, flen, ops, lits);
+
+    if (nsformats < SCANFCACHESZ) {
+	sf = &sfentries[nsformats++];
+    } else {
+	/* evict the least recently used format */
+	sf = sfoldest;
+	sfoldest = sf->newer;
+	if (sfoldest != (ScanFormat *) NULL) {
+	    sfoldest->older = (ScanFormat *) NULL;
 	} else {
-	    return FALSE;	/* no match */
+	    sfnewest = (ScanFormat *) NULL;
 	}
+	for (h = &sftab[sf->hash % SCANFCACHESZ]; *h != sf; h = &(*h)->next) ;
+	*h = sf->next;
+	FREE(sf->ops);
+    }
+    sf->hash = hash;
+    sf->flen = flen;
+    Alloc::staticMode();
+    sf->ops = (ScanOp *) ALLOC(char, nops * sizeof(ScanOp) + 2 * flen + 1);
+    Alloc::dynamicMode();
+    sf->format = (char *) (sf->ops + nops);
+    memcpy(sf->format, format, flen);
+    sf->lits = sf->format + flen;
+    memcpy(sf->lits, lits, flen + 1);
+    memcpy(sf->ops, ops, nops * sizeof(ScanOp));
+    AFREE(lits);
+    AFREE(ops);
+
+    h = &sftab[hash % SCANFCACHESZ];
+    sf->next = *h;
+    *h = sf;
+    sf->newer = (ScanFormat *) NULL;
+    sf->older = sfnewest;
+    if (sfnewest != (ScanFormat *) NULL) {
+	sfnewest->newer = sf;
+    } else {
+	sfoldest = sf;
     }
+    sfnewest = sf;
 
-    *slenp -= slen;
-    return TRUE;
+    return sf;
+}
+
+/*
+ * release a format that was compiled for a single call
+ */
+static void scanRelease(ScanFormat *sf)
+{
+    if (sf->format == (char *) NULL) {
+	/* not cached */
+	FREE(sf->lits);
+	FREE(sf->ops);
+	FREE(sf);
+    }
 }
 
 /*
@@ -436,14 +574,15 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
 	    char *text;			/* text of string */
 	};
     } results[MAX_LOCALS];
-    unsigned int flen, slen, size;
-    char *format, *x;
-    unsigned int fl, sl;
+    unsigned int slen, size;
+    char *x;
     int matches;
     char *s;
     Int i;
     Float flt;
-    bool skip;
+    bool found;
+    ScanFormat *sf;
+    ScanOp *op;
     Value *top, *elts;
     Array *a;
 
@@ -464,138 +603,90 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
     if (top[0].type != T_STRING) {
 	return 2;
     }
-    format = top[0].string->text;
-    flen = top[0].string->len;
 
     matches = 0;
     nargs = 0;
-
-    while (flen > 0) {
-	if (format[0] != '%' || format[1] == '%') {
-	    /* match initial part */
-	    fl = flen;
-	    sl = slen;
-	    if (!match(format, s, &fl, &sl) || fl == flen) {
-		goto no_match;
+    found = FALSE;
+
+    sf = scanFormat(top[0].string->text, top[0].string->len);
+    for (op = sf->ops; op->type != '\0'; op++) {
+	if (!found) {
+	    /* match literal text */
+	    if (op->llen > slen ||
+		memcmp(s, sf->lits + op->lit, op->llen) != 0) {
+		break;
 	    }
-	    format += fl;
-	    flen -= fl;
-	    s += sl;
-	    slen -= sl;
-	}
-
-	/* skip first % */
-	format++;
-	--flen;
-
-	/*
-	 * check for %*
-	 */
-	if (*format == '*') {
-	    /* no assignment */
-	    format++;
-	    --flen;
-	    skip = TRUE;
-	} else {
-	    skip = FALSE;
+	    s += op->llen;
+	    slen -= op->llen;
 	}
+	found = FALSE;
 
-	--flen;
-	switch (*format++) {
+	switch (op->type) {
 	case 's':
 	    /* %s */
-	    if (format[0] == '%' && format[1] != '%') {
-		switch ((format[1] == '*') ? format[2] : format[1]) {
-		case 'd':
-		    /*
-		     * %s%d
-		     */
-		    size = slen;
-		    x = s;
-		    while (!isdigit(*x)) {
-			if (slen == 0) {
-			    goto no_match;
-			}
-			if (x[0] == '-' && isdigit(x[1])) {
-			    break;
-			}
-			x++;
-			--slen;
+	    switch (op->until) {
+	    case 'd':
+		/*
+		 * %s%d
+		 */
+		size = slen;
+		x = s;
+		while (!isdigit(*x)) {
+		    if (slen == 0) {
+			goto no_match;
 		    }
-		    size -= slen;
-		    break;
-
-		case 'f':
-		    /*
-		     * %s%f
-		     */
-		    size = slen;
-		    x = s;
-		    while (!isdigit(*x)) {
-			if (slen == 0) {
-			    goto no_match;
-			}
-			if ((x[0] == '-' || x[0] == '.') && isdigit(x[1])) {
-			    break;
-			}
-			x++;
-			--slen;
+		    if (x[0] == '-' && isdigit(x[1])) {
+			break;
 		    }
-		    size -= slen;
-		    break;
-
-		default:
-		    error("Bad sscanf format string");
+		    x++;
+		    --slen;
 		}
-	    } else {
+		size -= slen;
+		break;
+
+	    case 'f':
 		/*
-		 * %s followed by non-%
+		 * %s%f
 		 */
-		if (flen == 0) {
-		    /* match whole string */
-		    size = slen;
-		    x = s + slen;
-		    slen = 0;
-		} else {
-		    /* get # of chars to match after string */
-		    for (x = format, size = 0; x - format != flen;
-			 x++, size++) {
-			x = (char *) memchr(x, '%', flen - (x - format));
-			if (x == (char *) NULL) {
-			    x = format + flen;
-			    break;
-			} else if (x[1] != '%') {
-			    break;
-			}
+		size = slen;
+		x = s;
+		while (!isdigit(*x)) {
+		    if (slen == 0) {
+			goto no_match;
 		    }
-		    size = (x - format) - size;
-
-		    x = s;
-		    for (;;) {
-			sl = slen - (x - s);
-			if (sl < size) {
-			    goto no_match;
-			}
-			x = (char *) memchr(x, format[0], sl - size + 1);
-			if (x == (char *) NULL) {
-			    goto no_match;
-			}
-			fl = flen;
-			if (match(format, x, &fl, &sl)) {
-			    format += fl;
-			    flen -= fl;
-			    size = x - s;
-			    x += sl;
-			    slen -= size + sl;
-			    break;
-			}
-			x++;
+		    if ((x[0] == '-' || x[0] == '.') && isdigit(x[1])) {
+			break;
 		    }
+		    x++;
+		    --slen;
 		}
+		size -= slen;
+		break;
+
+	    case 'l':
+		/*
+		 * %s followed by literal text, which is matched as well
+		 */
+		x = String::find(s, slen, sf->lits + op[1].lit, op[1].llen);
+		if (x == (char *) NULL) {
+		    goto no_match;
+		}
+		size = x - s;
+		x += op[1].llen;
+		slen -= size + op[1].llen;
+		found = TRUE;
+		break;
+
+	    default:
+		/* match whole string */
+		size = slen;
+		x = s + slen;
+		slen = 0;
+		break;
 	    }
 
 	    i_add_ticks(f, 8);
-	    if (!skip) {
+	    if (!op->skip) {
 		results[nargs].type = T_STRING;
 		results[nargs].len = size;
 		results[nargs].text = s;
@@ -619,7 +710,7 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
 	    slen -= (s - x);
 
 	    i_add_ticks(f, 8);
-	    if (!skip) {
+	    if (!op->skip) {
 		results[nargs].type = T_INT;
 		results[nargs].number = i;
 		nargs++;
@@ -640,7 +731,7 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
 	    slen -= (s - x);
 
 	    i_add_ticks(f, 8);
-	    if (!skip) {
+	    if (!op->skip) {
 		results[nargs].type = T_FLOAT;
 		results[nargs].fhigh = flt.high;
 		results[nargs].flow = flt.low;
@@ -654,7 +745,7 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
 		goto no_match;
 	    }
 	    i_add_ticks(f, 8);
-	    if (!skip) {
+	    if (!op->skip) {
 		results[nargs].type = T_INT;
 		results[nargs].number = UCHAR(*s);
 		nargs++;
@@ -664,12 +755,15 @@ int kf_sscanf(Frame *f, int nargs, KFun *kf)
 	    break;
 
 	default:
+	    scanRelease(sf);
 	    error("Bad sscanf format string");
 	}
 	matches++;
     }
 
 no_match:
+    scanRelease(sf);
+
     a = Array::create(f->data, nargs);
     for (elts = a->elts, size = 0; size < nargs; elts++, size++) {
 	switch (results[size].type) {
@@ -793,7 +887,7 @@ char pt_hash_crc16[] = { C_TYPECHECKED | C_STATIC | C_ELLIPSIS, 1, 1, 0, 8,
 			 T_INT, T_STRING, T_STRING };
 
 /*
- * Compute a 16 bit cyclic redundancy code for a string.
+ * Table for a 16 bit cyclic redundancy code.
  * Based on "A PAINLESS GUIDE TO CRC ERROR DETECTION ALGORITHMS",
  * by Ross N. Williams.
  *
@@ -806,46 +900,90 @@ char pt_hash_crc16[] = { C_TYPECHECKED | C_STATIC | C_ELLIPSIS, 1, 1, 0, 8,
  *     XorOut:	0000
  *     Check:	29B1
  */
+static unsigned short crc16tab[] = {
+    0x0000, 0x2110, 0x4220, 0x6330, 0x8440, 0xa550, 0xc660, 0xe770,
+    0x0881, 0x2991, 0x4aa1, 0x6bb1, 0x8cc1, 0xadd1, 0xcee1, 0xeff1,
+    0x3112, 0x1002, 0x7332, 0x5222, 0xb552, 0x9442, 0xf772, 0xd662,
+    0x3993, 0x1883, 0x7bb3, 0x5aa3, 0xbdd3, 0x9cc3, 0xfff3, 0xdee3,
+    0x6224, 0x4334, 0x2004, 0x0114, 0xe664, 0xc774, 0xa444, 0x8554,
+    0x6aa5, 0x4bb5, 0x2885, 0x0995, 0xeee5, 0xcff5, 0xacc5, 0x8dd5,
+    0x5336, 0x7226, 0x1116, 0x3006, 0xd776, 0xf666, 0x9556, 0xb446,
+    0x5bb7, 0x7aa7, 0x1997, 0x3887, 0xdff7, 0xfee7, 0x9dd7, 0xbcc7,
+    0xc448, 0xe558, 0x8668, 0xa778, 0x4008, 0x6118, 0x0228, 0x2338,
+    0xccc9, 0xedd9, 0x8ee9, 0xaff9, 0x4889, 0x6999, 0x0aa9, 0x2bb9,
+    0xf55a, 0xd44a, 0xb77a, 0x966a, 0x711a, 0x500a, 0x333a, 0x122a,
+    0xfddb, 0xdccb, 0xbffb, 0x9eeb, 0x799b, 0x588b, 0x3bbb, 0x1aab,
+    0xa66c, 0x877c, 0xe44c, 0xc55c, 0x222c, 0x033c, 0x600c, 0x411c,
+    0xaeed, 0x8ffd, 0xeccd, 0xcddd, 0x2aad, 0x0bbd, 0x688d, 0x499d,
+    0x977e, 0xb66e, 0xd55e, 0xf44e, 0x133e, 0x322e, 0x511e, 0x700e,
+    0x9fff, 0xbeef, 0xdddf, 0xfccf, 0x1bbf, 0x3aaf, 0x599f, 0x788f,
+    0x8891, 0xa981, 0xcab1, 0xeba1, 0x0cd1, 0x2dc1, 0x4ef1, 0x6fe1,
+    0x8010, 0xa100, 0xc230, 0xe320, 0x0450, 0x2540, 0x4670, 0x6760,
+    0xb983, 0x9893, 0xfba3, 0xdab3, 0x3dc3, 0x1cd3, 0x7fe3, 0x5ef3,
+    0xb102, 0x9012, 0xf322, 0xd232, 0x3542, 0x1452, 0x7762, 0x5672,
+    0xeab5, 0xcba5, 0xa895, 0x8985, 0x6ef5, 0x4fe5, 0x2cd5, 0x0dc5,
+    0xe234, 0xc324, 0xa014, 0x8104, 0x6674, 0x4764, 0x2454, 0x0544,
+    0xdba7, 0xfab7, 0x9987, 0xb897, 0x5fe7, 0x7ef7, 0x1dc7, 0x3cd7,
+    0xd326, 0xf236, 0x9106, 0xb016, 0x5766, 0x7676, 0x1546, 0x3456,
+    0x4cd9, 0x6dc9, 0x0ef9, 0x2fe9, 0xc899, 0xe989, 0x8ab9, 0xaba9,
+    0x4458, 0x6548, 0x0678, 0x2768, 0xc018, 0xe108, 0x8238, 0xa328,
+    0x7dcb, 0x5cdb, 0x3feb, 0x1efb, 0xf98b, 0xd89b, 0xbbab, 0x9abb,
+    0x754a, 0x545a, 0x376a, 0x167a, 0xf10a, 0xd01a, 0xb32a, 0x923a,
+    0x2efd, 0x0fed, 0x6cdd, 0x4dcd, 0xaabd, 0x8bad, 0xe89d, 0xc98d,
+    0x267c, 0x076c, 0x645c, 0x454c, 0xa23c, 0x832c, 0xe01c, 0xc10c,
+    0x1fef, 0x3eff, 0x5dcf, 0x7cdf, 0x9baf, 0xbabf, 0xd98f, 0xf89f,
+    0x176e, 0x367e, 0x554e, 0x745e, 0x932e, 0xb23e, 0xd10e, 0xf01e
+};
+
+static unsigned short crc16slice[7][256];	/* slice-by-8 tables */
+static bool crc16init;			/* slice tables initialized? */
+
+/*
+ * add a string to a CRC-16, 8 bytes at a time
+ */
+static unsigned short hash_crc16(unsigned short crc, char *p, ssizet len)
+{
+    unsigned short c;
+    int i, j;
+
+    if (len >= 8) {
+	if (!crc16init) {
+	    /* each table advances the CRC over one more nil byte */
+	    for (i = 0; i < 256; i++) {
+		c = crc16tab[i];
+		for (j = 0; j < 7; j++) {
+		    c = (c >> 8) ^ crc16tab[c & 0xff];
+		    crc16slice[j][i] = c;
+		}
+	    }
+	    crc16init = TRUE;
+	}
+
+	do {
+	    crc ^= UCHAR(p[0]) | (UCHAR(p[1]) << 8);
+	    crc = crc16slice[6][crc & 0xff] ^ crc16slice[5][crc >> 8] ^
+		  crc16slice[4][UCHAR(p[2])] ^ crc16slice[3][UCHAR(p[3])] ^
+		  crc16slice[2][UCHAR(p[4])] ^ crc16slice[1][UCHAR(p[5])] ^
+		  crc16slice[0][UCHAR(p[6])] ^ crc16tab[UCHAR(p[7])];
+	    p += 8;
+	    len -= 8;
+	} while (len >= 8);
+    }
+
+    while (len != 0) {
+	crc = (crc >> 8) ^ crc16tab[UCHAR(crc ^ *p++)];
+	--len;
+    }
+    return crc;
+}
+
+/*
+ * compute a 16 bit cyclic redundancy code for strings
+ */
 int kf_hash_crc16(Frame *f, int nargs, KFun *kf)
 {
-    static unsigned short crctab[] = {
-	0x0000, 0x2110, 0x4220, 0x6330, 0x8440, 0xa550, 0xc660, 0xe770,
-	0x0881, 0x2991, 0x4aa1, 0x6bb1, 0x8cc1, 0xadd1, 0xcee1, 0xeff1,
-	0x3112, 0x1002, 0x7332, 0x5222, 0xb552, 0x9442, 0xf772, 0xd662,
-	0x3993, 0x1883, 0x7bb3, 0x5aa3, 0xbdd3, 0x9cc3, 0xfff3, 0xdee3,
-	0x6224, 0x4334, 0x2004, 0x0114, 0xe664, 0xc774, 0xa444, 0x8554,
-	0x6aa5, 0x4bb5, 0x2885, 0x0995, 0xeee5, 0xcff5, 0xacc5, 0x8dd5,
-	0x5336, 0x7226, 0x1116, 0x3006, 0xd776, 0xf666, 0x9556, 0xb446,
-	0x5bb7, 0x7aa7, 0x1997, 0x3887, 0xdff7, 0xfee7, 0x9dd7, 0xbcc7,
-	0xc448, 0xe558, 0x8668, 0xa778, 0x4008, 0x6118, 0x0228, 0x2338,
-	0xccc9, 0xedd9, 0x8ee9, 0xaff9, 0x4889, 0x6999, 0x0aa9, 0x2bb9,
-	0xf55a, 0xd44a, 0xb77a, 0x966a, 0x711a, 0x500a, 0x333a, 0x122a,
-	0xfddb, 0xdccb, 0xbffb, 0x9eeb, 0x799b, 0x588b, 0x3bbb, 0x1aab,
-	0xa66c, 0x877c, 0xe44c, 0xc55c, 0x222c, 0x033c, 0x600c, 0x411c,
-	0xaeed, 0x8ffd, 0xeccd, 0xcddd, 0x2aad, 0x0bbd, 0x688d, 0x499d,
-	0x977e, 0xb66e, 0xd55e, 0xf44e, 0x133e, 0x322e, 0x511e, 0x700e,
-	0x9fff, 0xbeef, 0xdddf, 0xfccf, 0x1bbf, 0x3aaf, 0x599f, 0x788f,
-	0x8891, 0xa981, 0xcab1, 0xeba1, 0x0cd1, 0x2dc1, 0x4ef1, 0x6fe1,
-	0x8010, 0xa100, 0xc230, 0xe320, 0x0450, 0x2540, 0x4670, 0x6760,
-	0xb983, 0x9893, 0xfba3, 0xdab3, 0x3dc3, 0x1cd3, 0x7fe3, 0x5ef3,
-	0xb102, 0x9012, 0xf322, 0xd232, 0x3542, 0x1452, 0x7762, 0x5672,
-	0xeab5, 0xcba5, 0xa895, 0x8985, 0x6ef5, 0x4fe5, 0x2cd5, 0x0dc5,
-	0xe234, 0xc324, 0xa014, 0x8104, 0x6674, 0x4764, 0x2454, 0x0544,
-	0xdba7, 0xfab7, 0x9987, 0xb897, 0x5fe7, 0x7ef7, 0x1dc7, 0x3cd7,
-	0xd326, 0xf236, 0x9106, 0xb016, 0x5766, 0x7676, 0x1546, 0x3456,
-	0x4cd9, 0x6dc9, 0x0ef9, 0x2fe9, 0xc899, 0xe989, 0x8ab9, 0xaba9,
-	0x4458, 0x6548, 0x0678, 0x2768, 0xc018, 0xe108, 0x8238, 0xa328,
-	0x7dcb, 0x5cdb, 0x3feb, 0x1efb, 0xf98b, 0xd89b, 0xbbab, 0x9abb,
-	0x754a, 0x545a, 0x376a, 0x167a, 0xf10a, 0xd01a, 0xb32a, 0x923a,
-	0x2efd, 0x0fed, 0x6cdd, 0x4dcd, 0xaabd, 0x8bad, 0xe89d, 0xc98d,
-	0x267c, 0x076c, 0x645c, 0x454c, 0xa23c, 0x832c, 0xe01c, 0xc10c,
-	0x1fef, 0x3eff, 0x5dcf, 0x7cdf, 0x9baf, 0xbabf, 0xd98f, 0xf89f,
-	0x176e, 0x367e, 0x554e, 0x745e, 0x932e, 0xb23e, 0xd10e, 0xf01e
-    };
     unsigned short crc;
     int i;
-    ssizet len;
-    char *p;
     Int cost;
 
     UNREFERENCED_PARAMETER(kf);
@@ -863,10 +1001,7 @@ int kf_hash_crc16(Frame *f, int nargs, KFun *kf)
 
     crc = 0xffff;
     for (i = nargs; --i >= 0; ) {
-	p = f->sp[i].string->text;
-	for (len = f->sp[i].string->len; len != 0; --len) {
-	    crc = (crc >> 8) ^ crctab[UCHAR(crc ^ *p++)];
-	}
+	crc = hash_crc16(crc, f->sp[i].string->text, f->sp[i].string->len);
 	f->sp[i].string->del();
     }
     crc = (crc >> 8) + (crc << 8);
@@ -885,7 +1020,7 @@ char pt_hash_crc32[] = { C_TYPECHECKED | C_STATIC | C_ELLIPSIS, 1, 1, 0, 8,
 			 T_INT, T_STRING, T_STRING };
 
 /*
- * Compute a 32 bit cyclic redundancy code for a string.
+ * Table for a 32 bit cyclic redundancy code.
  * Based on "A PAINLESS GUIDE TO CRC ERROR DETECTION ALGORITHMS",
  * by Ross N. Williams.
  *
@@ -898,66 +1033,111 @@ char pt_hash_crc32[] = { C_TYPECHECKED | C_STATIC | C_ELLIPSIS, 1, 1, 0, 8,
  *     XorOut:	FFFFFFFF
  *     Check:	CBF43926
  */
+static Uint crctab[] = {
+    0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L,
+    0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0x0edb8832L, 0x79dcb8a4L,
+    0xe0d5e91eL, 0x97d2d988L, 0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L,
+    0x90bf1d91L, 0x1db71064L, 0x6ab020f2L, 0xf3b97148L, 0x84be41deL,
+    0x1adad47dL, 0x6ddde4ebL, 0xf4d4b551L, 0x83d385c7L, 0x136c9856L,
+    0x646ba8c0L, 0xfd62f97aL, 0x8a65c9ecL, 0x14015c4fL, 0x63066cd9L,
+    0xfa0f3d63L, 0x8d080df5L, 0x3b6e20c8L, 0x4c69105eL, 0xd56041e4L,
+    0xa2677172L, 0x3c03e4d1L, 0x4b04d447L, 0xd20d85fdL, 0xa50ab56bL,
+    0x35b5a8faL, 0x42b2986cL, 0xdbbbc9d6L, 0xacbcf940L, 0x32d86ce3L,
+    0x45df5c75L, 0xdcd60dcfL, 0xabd13d59L, 0x26d930acL, 0x51de003aL,
+    0xc8d75180L, 0xbfd06116L, 0x21b4f4b5L, 0x56b3c423L, 0xcfba9599L,
+    0xb8bda50fL, 0x2802b89eL, 0x5f058808L, 0xc60cd9b2L, 0xb10be924L,
+    0x2f6f7c87L, 0x58684c11L, 0xc1611dabL, 0xb6662d3dL, 0x76dc4190L,
+    0x01db7106L, 0x98d220bcL, 0xefd5102aL, 0x71b18589L, 0x06b6b51fL,
+    0x9fbfe4a5L, 0xe8b8d433L, 0x7807c9a2L, 0x0f00f934L, 0x9609a88eL,
+    0xe10e9818L, 0x7f6a0dbbL, 0x086d3d2dL, 0x91646c97L, 0xe6635c01L,
+    0x6b6b51f4L, 0x1c6c6162L, 0x856530d8L, 0xf262004eL, 0x6c0695edL,
+    0x1b01a57bL, 0x8208f4c1L, 0xf50fc457L, 0x65b0d9c6L, 0x12b7e950L,
+    0x8bbeb8eaL, 0xfcb9887cL, 0x62dd1ddfL, 0x15da2d49L, 0x8cd37cf3L,
+    0xfbd44c65L, 0x4db26158L, 0x3ab551ceL, 0xa3bc0074L, 0xd4bb30e2L,
+    0x4adfa541L, 0x3dd895d7L, 0xa4d1c46dL, 0xd3d6f4fbL, 0x4369e96aL,
+    0x346ed9fcL, 0xad678846L, 0xda60b8d0L, 0x44042d73L, 0x33031de5L,
+    0xaa0a4c5fL, 0xdd0d7cc9L, 0x5005713cL, 0x270241aaL, 0xbe0b1010L,
+    0xc90c2086L, 0x5768b525L, 0x206f85b3L, 0xb966d409L, 0xce61e49fL,
+    0x5edef90eL, 0x29d9c998L, 0xb0d09822L, 0xc7d7a8b4L, 0x59b33d17L,
+    0x2eb40d81L, 0xb7bd5c3bL, 0xc0ba6cadL, 0xedb88320L, 0x9abfb3b6L,
+    0x03b6e20cL, 0x74b1d29aL, 0xead54739L, 0x9dd277afL, 0x04db2615L,
+    0x73dc1683L, 0xe3630b12L, 0x94643b84L, 0x0d6d6a3eL, 0x7a6a5aa8L,
+    0xe40ecf0bL, 0x9309ff9dL, 0x0a00ae27L, 0x7d079eb1L, 0xf00f9344L,
+    0x8708a3d2L, 0x1e01f268L, 0x6906c2feL, 0xf762575dL, 0x806567cbL,
+    0x196c3671L, 0x6e6b06e7L, 0xfed41b76L, 0x89d32be0L, 0x10da7a5aL,
+    0x67dd4accL, 0xf9b9df6fL, 0x8ebeeff9L, 0x17b7be43L, 0x60b08ed5L,
+    0xd6d6a3e8L, 0xa1d1937eL, 0x38d8c2c4L, 0x4fdff252L, 0xd1bb67f1L,
+    0xa6bc5767L, 0x3fb506ddL, 0x48b2364bL, 0xd80d2bdaL, 0xaf0a1b4cL,
+    0x36034af6L, 0x41047a60L, 0xdf60efc3L, 0xa867df55L, 0x316e8eefL,
+    0x4669be79L, 0xcb61b38cL, 0xbc66831aL, 0x256fd2a0L, 0x5268e236L,
+    0xcc0c7795L, 0xbb0b4703L, 0x220216b9L, 0x5505262fL, 0xc5ba3bbeL,
+    0xb2bd0b28L, 0x2bb45a92L, 0x5cb36a04L, 0xc2d7ffa7L, 0xb5d0cf31L,
+    0x2cd99e8bL, 0x5bdeae1dL, 0x9b64c2b0L, 0xec63f226L, 0x756aa39cL,
+    0x026d930aL, 0x9c0906a9L, 0xeb0e363fL, 0x72076785L, 0x05005713L,
+    0x95bf4a82L, 0xe2b87a14L, 0x7bb12baeL, 0x0cb61b38L, 0x92d28e9bL,
+    0xe5d5be0dL, 0x7cdcefb7L, 0x0bdbdf21L, 0x86d3d2d4L, 0xf1d4e242L,
+    0x68ddb3f8L, 0x1fda836eL, 0x81be16cdL, 0xf6b9265bL, 0x6fb077e1L,
+    0x18b74777L, 0x88085ae6L, 0xff0f6a70L, 0x66063bcaL, 0x11010b5cL,
+    0x8f659effL, 0xf862ae69L, 0x616bffd3L, 0x166ccf45L, 0xa00ae278L,
+    0xd70dd2eeL, 0x4e048354L, 0x3903b3c2L, 0xa7672661L, 0xd06016f7L,
+    0x4969474dL, 0x3e6e77dbL, 0xaed16a4aL, 0xd9d65adcL, 0x40df0b66L,
+    0x37d83bf0L, 0xa9bcae53L, 0xdebb9ec5L, 0x47b2cf7fL, 0x30b5ffe9L,
+    0xbdbdf21cL, 0xcabac28aL, 0x53b39330L, 0x24b4a3a6L, 0xbad03605L,
+    0xcdd70693L, 0x54de5729L, 0x23d967bfL, 0xb3667a2eL, 0xc4614ab8L,
+    0x5d681b02L, 0x2a6f2b94L, 0xb40bbe37L, 0xc30c8ea1L, 0x5a05df1bL,
+    0x2d02ef8dL
+};
+
+static Uint crc32slice[7][256];	/* slice-by-8 tables */
+static bool crc32init;			/* slice tables initialized? */
+
+/*
+ * add a string to a CRC-32, 8 bytes at a time
+ */
+static Uint hash_crc32(Uint crc, char *p, ssizet len)
+{
+    Uint c;
+    int i, j;
+
+    if (len >= 8) {
+	if (!crc32init) {
+	    /* each table advances the CRC over one more nil byte */
+	    for (i = 0; i < 256; i++) {
+		c = crctab[i];
+		for (j = 0; j < 7; j++) {
+		    c = (c >> 8) ^ crctab[c & 0xff];
+		    crc32slice[j][i] = c;
+		}
+	    }
+	    crc32init = TRUE;
+	}
+
+	do {
+	    crc ^= UCHAR(p[0]) | (UCHAR(p[1]) << 8) | (UCHAR(p[2]) << 16) |
+		   ((Uint) UCHAR(p[3]) << 24);
+	    crc = crc32slice[6][crc & 0xff] ^ crc32slice[5][(crc >> 8) & 0xff] ^
+		  crc32slice[4][(crc >> 16) & 0xff] ^ crc32slice[3][crc >> 24] ^
+		  crc32slice[2][UCHAR(p[4])] ^ crc32slice[1][UCHAR(p[5])] ^
+		  crc32slice[0][UCHAR(p[6])] ^ crctab[UCHAR(p[7])];
+	    p += 8;
+	    len -= 8;
+	} while (len >= 8);
+    }
+
+    while (len != 0) {
+	crc = (crc >> 8) ^ crctab[UCHAR(crc ^ *p++)];
+	--len;
+    }
+    return crc;
+}
+
+/*
+ * compute a 32 bit cyclic redundancy code for strings
+ */
 int kf_hash_crc32(Frame *f, int nargs, KFun *kf)
 {
-    static Uint crctab[] = {
-	0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L,
-	0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0x0edb8832L, 0x79dcb8a4L,
-	0xe0d5e91eL, 0x97d2d988L, 0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L,
-	0x90bf1d91L, 0x1db71064L, 0x6ab020f2L, 0xf3b97148L, 0x84be41deL,
-	0x1adad47dL, 0x6ddde4ebL, 0xf4d4b551L, 0x83d385c7L, 0x136c9856L,
-	0x646ba8c0L, 0xfd62f97aL, 0x8a65c9ecL, 0x14015c4fL, 0x63066cd9L,
-	0xfa0f3d63L, 0x8d080df5L, 0x3b6e20c8L, 0x4c69105eL, 0xd56041e4L,
-	0xa2677172L, 0x3c03e4d1L, 0x4b04d447L, 0xd20d85fdL, 0xa50ab56bL,
-	0x35b5a8faL, 0x42b2986cL, 0xdbbbc9d6L, 0xacbcf940L, 0x32d86ce3L,
-	0x45df5c75L, 0xdcd60dcfL, 0xabd13d59L, 0x26d930acL, 0x51de003aL,
-	0xc8d75180L, 0xbfd06116L, 0x21b4f4b5L, 0x56b3c423L, 0xcfba9599L,
-	0xb8bda50fL, 0x2802b89eL, 0x5f058808L, 0xc60cd9b2L, 0xb10be924L,
-	0x2f6f7c87L, 0x58684c11L, 0xc1611dabL, 0xb6662d3dL, 0x76dc4190L,
-	0x01db7106L, 0x98d220bcL, 0xefd5102aL, 0x71b18589L, 0x06b6b51fL,
-	0x9fbfe4a5L, 0xe8b8d433L, 0x7807c9a2L, 0x0f00f934L, 0x9609a88eL,
-	0xe10e9818L, 0x7f6a0dbbL, 0x086d3d2dL, 0x91646c97L, 0xe6635c01L,
-	0x6b6b51f4L, 0x1c6c6162L, 0x856530d8L, 0xf262004eL, 0x6c0695edL,
-	0x1b01a57bL, 0x8208f4c1L, 0xf50fc457L, 0x65b0d9c6L, 0x12b7e950L,
-	0x8bbeb8eaL, 0xfcb9887cL, 0x62dd1ddfL, 0x15da2d49L, 0x8cd37cf3L,
-	0xfbd44c65L, 0x4db26158L, 0x3ab551ceL, 0xa3bc0074L, 0xd4bb30e2L,
-	0x4adfa541L, 0x3dd895d7L, 0xa4d1c46dL, 0xd3d6f4fbL, 0x4369e96aL,
-	0x346ed9fcL, 0xad678846L, 0xda60b8d0L, 0x44042d73L, 0x33031de5L,
-	0xaa0a4c5fL, 0xdd0d7cc9L, 0x5005713cL, 0x270241aaL, 0xbe0b1010L,
-	0xc90c2086L, 0x5768b525L, 0x206f85b3L, 0xb966d409L, 0xce61e49fL,
-	0x5edef90eL, 0x29d9c998L, 0xb0d09822L, 0xc7d7a8b4L, 0x59b33d17L,
-	0x2eb40d81L, 0xb7bd5c3bL, 0xc0ba6cadL, 0xedb88320L, 0x9abfb3b6L,
-	0x03b6e20cL, 0x74b1d29aL, 0xead54739L, 0x9dd277afL, 0x04db2615L,
-	0x73dc1683L, 0xe3630b12L, 0x94643b84L, 0x0d6d6a3eL, 0x7a6a5aa8L,
-	0xe40ecf0bL, 0x9309ff9dL, 0x0a00ae27L, 0x7d079eb1L, 0xf00f9344L,
-	0x8708a3d2L, 0x1e01f268L, 0x6906c2feL, 0xf762575dL, 0x806567cbL,
-	0x196c3671L, 0x6e6b06e7L, 0xfed41b76L, 0x89d32be0L, 0x10da7a5aL,
-	0x67dd4accL, 0xf9b9df6fL, 0x8ebeeff9L, 0x17b7be43L, 0x60b08ed5L,
-	0xd6d6a3e8L, 0xa1d1937eL, 0x38d8c2c4L, 0x4fdff252L, 0xd1bb67f1L,
-	0xa6bc5767L, 0x3fb506ddL, 0x48b2364bL, 0xd80d2bdaL, 0xaf0a1b4cL,
-	0x36034af6L, 0x41047a60L, 0xdf60efc3L, 0xa867df55L, 0x316e8eefL,
-	0x4669be79L, 0xcb61b38cL, 0xbc66831aL, 0x256fd2a0L, 0x5268e236L,
-	0xcc0c7795L, 0xbb0b4703L, 0x220216b9L, 0x5505262fL, 0xc5ba3bbeL,
-	0xb2bd0b28L, 0x2bb45a92L, 0x5cb36a04L, 0xc2d7ffa7L, 0xb5d0cf31L,
-	0x2cd99e8bL, 0x5bdeae1dL, 0x9b64c2b0L, 0xec63f226L, 0x756aa39cL,
-	0x026d930aL, 0x9c0906a9L, 0xeb0e363fL, 0x72076785L, 0x05005713L,
-	0x95bf4a82L, 0xe2b87a14L, 0x7bb12baeL, 0x0cb61b38L, 0x92d28e9bL,
-	0xe5d5be0dL, 0x7cdcefb7L, 0x0bdbdf21L, 0x86d3d2d4L, 0xf1d4e242L,
-	0x68ddb3f8L, 0x1fda836eL, 0x81be16cdL, 0xf6b9265bL, 0x6fb077e1L,
-	0x18b74777L, 0x88085ae6L, 0xff0f6a70L, 0x66063bcaL, 0x11010b5cL,
-	0x8f659effL, 0xf862ae69L, 0x616bffd3L, 0x166ccf45L, 0xa00ae278L,
-	0xd70dd2eeL, 0x4e048354L, 0x3903b3c2L, 0xa7672661L, 0xd06016f7L,
-	0x4969474dL, 0x3e6e77dbL, 0xaed16a4aL, 0xd9d65adcL, 0x40df0b66L,
-	0x37d83bf0L, 0xa9bcae53L, 0xdebb9ec5L, 0x47b2cf7fL, 0x30b5ffe9L,
-	0xbdbdf21cL, 0xcabac28aL, 0x53b39330L, 0x24b4a3a6L, 0xbad03605L,
-	0xcdd70693L, 0x54de5729L, 0x23d967bfL, 0xb3667a2eL, 0xc4614ab8L,
-	0x5d681b02L, 0x2a6f2b94L, 0xb40bbe37L, 0xc30c8ea1L, 0x5a05df1bL,
-	0x2d02ef8dL
-    };
     Uint crc;
     int i;
-    ssizet len;
-    char *p;
     Int cost;
 
     UNREFERENCED_PARAMETER(kf);
@@ -975,10 +1155,7 @@ int kf_hash_crc32(Frame *f, int nargs, KFun *kf)
 
     crc = 0xffffffff;
     for (i = nargs; --i >= 0; ) {
-	p = f->sp[i].string->text;
-	for (len = f->sp[i].string->len; len != 0; --len) {
-	    crc = (crc >> 8) ^ crctab[UCHAR(crc ^ *p++)];
-	}
+	crc = hash_crc32(crc, f->sp[i].string->text, f->sp[i].string->len);
 	f->sp[i].string->del();
     }
     crc ^= 0xffffffffL;
@@ -1153,27 +1330,59 @@ void hash_md5_block(Uint *ABCD, char *block)
 }
 
 /*
- * finish up MD5 hash
+ * store the bit length of a message in the last 8 bytes of a block
  */
-void hash_md5_end(char *hash, Uint *digest, char *buffer, unsigned int bufsz,
-		  Uint length)
+static void hash_length(char *block, Uuint length, bool bigendian)
 {
     int i;
 
-    /* append padding and digest final block(s) */
+    length <<= 3;
+    for (i = 0; i < 8; i++, length >>= 8) {
+	block[(bigendian) ? 63 - i : 56 + i] = (char) length;
+    }
+}
+
+/*
+ * append padding and digest final block(s)
+ */
+static void hash_pad(Uint *digest, char *buffer, unsigned int bufsz,
+		     Uuint length, bool bigendian,
+		     void (*hash_block) (Uint*, char*))
+{
     buffer[bufsz++] = '\x80';
     if (bufsz > 56) {
 	memset(buffer + bufsz, '\0', 64 - bufsz);
-	hash_md5_block(digest, buffer);
+	(*hash_block)(digest, buffer);
 	bufsz = 0;
     }
     memset(buffer + bufsz, '\0', 64 - bufsz);
-    buffer[56] = length << 3;
-    buffer[57] = length >> 5;
-    buffer[58] = length >> 13;
-    buffer[59] = length >> 21;
-    buffer[60] = length >> 29;
-    hash_md5_block(digest, buffer);
+    hash_length(buffer, length, bigendian);
+    (*hash_block)(digest, buffer);
+}
+
+/*
+ * store digest words as a big-endian hash value
+ */
+static void hash_digest(char *buffer, Uint *digest, int nwords)
+{
+    while (--nwords >= 0) {
+	buffer[0] = *digest >> 24;
+	buffer[1] = *digest >> 16;
+	buffer[2] = *digest >> 8;
+	buffer[3] = *digest++;
+	buffer += 4;
+    }
+}
+
+/*
+ * finish up MD5 hash, with a 64 bit message length
+ */
+static void hash_md5_final(char *hash, Uint *digest, char *buffer,
+			   unsigned int bufsz, Uuint length)
+{
+    int i;
+
+    hash_pad(digest, buffer, bufsz, length, FALSE, &hash_md5_block);
 
     for (i = 0; i < 4; hash += 4, i++) {
 	hash[0] = digest[i];
@@ -1184,43 +1393,69 @@ void hash_md5_end(char *hash, Uint *digest, char *buffer, unsigned int bufsz,
 }
 
 /*
- * SHA-1 message digest.  See FIPS 180-2.
+ * finish up MD5 hash
  */
-static Int hash_sha1_start(Frame *f, int nargs, Uint *digest)
+void hash_md5_end(char *hash, Uint *digest, char *buffer, unsigned int bufsz,
+		  Uint length)
 {
-    Int cost;
+    hash_md5_final(hash, digest, buffer, bufsz, length);
+}
+
+/*
+ * finish up MD5 hash, and return it as a string
+ */
+static void hash_md5_value(Value *val, Uint *digest, char *buffer,
+			   unsigned int bufsz, Uuint length)
+{
+    String *str;
+
+    hash_md5_final(buffer, digest, buffer, bufsz, length);
+    str = String::create(buffer, 16);
+    PUT_STRVAL_NOREF(val, str);
+}
 
+/*
+ * SHA-1 message digest.  See FIPS 180-2.
+ */
+static void hash_sha1_start(Uint *digest)
+{
     digest[0] = 0x67452301L;
     digest[1] = 0xefcdab89L;
     digest[2] = 0x98badcfeL;
     digest[3] = 0x10325476L;
     digest[4] = 0xc3d2e1f0L;
-
-    cost = 3 * nargs + 64;
-    while (--nargs >= 0) {
-	cost += f->sp[nargs].string->len;
-    }
-    return cost;
 }
 
+# define F1(b, c, d)			(((c ^ d) & b) ^ d)
+# define F2(b, c, d)			(b ^ c ^ d)
+# define F3(b, c, d)			((b & c) | ((b | c) & d))
+# define W1(i)				W[i]
+# define W2(i)				(W[(i) & 15] = ROTL(W[((i) + 13) & 15] ^ \
+							W[((i) + 8) & 15] ^  \
+							W[((i) + 2) & 15] ^  \
+							W[(i) & 15], 1))
+# define S1(a, b, c, d, e, F, k, w)	(e += ROTL(a, 5) + F(b, c, d) + k + w, \
+					 b = ROTL(b, 30))
+# define S5(F, k, W, i)			(S1(a, b, c, d, e, F, k, W(i)),	    \
+					 S1(e, a, b, c, d, F, k, W(i + 1)), \
+					 S1(d, e, a, b, c, F, k, W(i + 2)), \
+					 S1(c, d, e, a, b, F, k, W(i + 3)), \
+					 S1(b, c, d, e, a, F, k, W(i + 4)))
+
 /*
  * add another 512 bit block to the message digest
  */
 static void hash_sha1_block(Uint *ABCDE, char *block)
 {
-    Uint W[80];
+    Uint W[16];
     int i, j;
-    Uint a, b, c, d, e, t;
+    Uint a, b, c, d, e;
 
     for (i = j = 0; i < 16; i++, j += 4) {
        W[i] = (UCHAR(block[j + 0]) << 24) | (UCHAR(block[j + 1]) << 16) |
 	      (UCHAR(block[j + 2]) << 8) | UCHAR(block[j + 3]);
 
     }
-    while (i < 80) {
-	W[i] = ROTL(W[i - 3] ^ W[i - 8] ^ W[i - 14] ^ W[i - 16], 1);
-	i++;
-    }
 
     a = ABCDE[0];
     b = ABCDE[1];
@@ -1228,40 +1463,26 @@ static void hash_sha1_block(Uint *ABCDE, char *block)
     d = ABCDE[3];
     e = ABCDE[4];
 
-    for (i = 0; i < 20; i++) {
-	t = ROTL(a, 5) + (((c ^ d) & b) ^ d) + e + W[i] + 0x5a827999L;
-	e = d;
-	d = c;
-	c = ROTL(b, 30);
-	b = a;
-	a = t;
-    }
-    while (i < 40) {
-	t = ROTL(a, 5) + (b ^ c ^ d) + e + W[i] + 0x6ed9eba1L;
-	e = d;
-	d = c;
-	c = ROTL(b, 30);
-	b = a;
-	a = t;
-	i++;
+    /*
+     * 5 rounds at a time, after which the variables are back in place;
+     * the message schedule is expanded in place, 16 words at a time
+     */
+    S5(F1, 0x5a827999L, W1, 0);
+    S5(F1, 0x5a827999L, W1, 5);
+    S5(F1, 0x5a827999L, W1, 10);
+    S1(a, b, c, d, e, F1, 0x5a827999L, W[15]);
+    S1(e, a, b, c, d, F1, 0x5a827999L, W2(16));
+    S1(d, e, a, b, c, F1, 0x5a827999L, W2(17));
+    S1(c, d, e, a, b, F1, 0x5a827999L, W2(18));
+    S1(b, c, d, e, a, F1, 0x5a827999L, W2(19));
+    for (i = 20; i < 40; i += 5) {
+	S5(F2, 0x6ed9eba1L, W2, i);
     }
-    while (i < 60) {
-	t = ROTL(a, 5) + ((b & c) | ((b | c) & d)) + e + W[i] + 0x8f1bbcdcL;
-	e = d;
-	d = c;
-	c = ROTL(b, 30);
-	b = a;
-	a = t;
-	i++;
+    for (; i < 60; i += 5) {
+	S5(F3, 0x8f1bbcdcL, W2, i);
     }
-    while (i < 80) {
-	t = ROTL(a, 5) + (b ^ c ^ d) + e + W[i] + 0xca62c1d6L;
-	e = d;
-	d = c;
-	c = ROTL(b, 30);
-	b = a;
-	a = t;
-	i++;
+    for (; i < 80; i += 5) {
+	S5(F2, 0xca62c1d6L, W2, i);
     }
 
     ABCDE[0] += a;
@@ -1271,38 +1492,183 @@ static void hash_sha1_block(Uint *ABCDE, char *block)
     ABCDE[4] += e;
 }
 
-
 /*
  * finish up SHA-1 hash
  */
-static String *hash_sha1_end(Uint *digest, char *buffer, unsigned int bufsz, Uint length)
+static void hash_sha1_value(Value *val, Uint *digest, char *buffer,
+			    unsigned int bufsz, Uuint length)
 {
-    int i;
+    String *str;
 
-    /* append padding and digest final block(s) */
-    buffer[bufsz++] = '\x80';
-    if (bufsz > 56) {
-	memset(buffer + bufsz, '\0', 64 - bufsz);
-	hash_sha1_block(digest, buffer);
-	bufsz = 0;
+    hash_pad(digest, buffer, bufsz, length, TRUE, &hash_sha1_block);
+    hash_digest(buffer, digest, 5);
+    str = String::create(buffer, 20);
+    PUT_STRVAL_NOREF(val, str);
+}
+
+/*
+ * SHA-256 message digest.  See FIPS 180-2.
+ */
+static void hash_sha256_start(Uint *digest)
+{
+    digest[0] = 0x6a09e667L;
+    digest[1] = 0xbb67ae85L;
+    digest[2] = 0x3c6ef372L;
+    digest[3] = 0xa54ff53aL;
+    digest[4] = 0x510e527fL;
+    digest[5] = 0x9b05688cL;
+    digest[6] = 0x1f83d9abL;
+    digest[7] = 0x5be0cd19L;
+}
+
+# define ROTR(x, s)			(((x) >> s) | ((x) << (32 - s)))
+# define W3(i)				W[i]
+# define W4(i)				(W[(i) & 15] +=			     \
+					 (ROTR(W[((i) + 14) & 15], 17) ^     \
+					  ROTR(W[((i) + 14) & 15], 19) ^     \
+					  (W[((i) + 14) & 15] >> 10)) +	     \
+					 W[((i) + 9) & 15] +		     \
+					 (ROTR(W[((i) + 1) & 15], 7) ^	     \
+					  ROTR(W[((i) + 1) & 15], 18) ^	     \
+					  (W[((i) + 1) & 15] >> 3)))
+# define S2(a, b, c, d, e, f, g, h, W, i) (h += (ROTR(e, 6) ^ ROTR(e, 11) ^  \
+					       ROTR(e, 25)) +		     \
+					      (((f ^ g) & e) ^ g) + K[i] +   \
+					      W(i),			     \
+					 d += h,			     \
+					 h += (ROTR(a, 2) ^ ROTR(a, 13) ^    \
+					       ROTR(a, 22)) +		     \
+					      ((a & b) | ((a | b) & c)))
+# define S8(W, i)			(S2(a, b, c, d, e, f, g, h, W, i),     \
+					 S2(h, a, b, c, d, e, f, g, W, i + 1), \
+					 S2(g, h, a, b, c, d, e, f, W, i + 2), \
+					 S2(f, g, h, a, b, c, d, e, W, i + 3), \
+					 S2(e, f, g, h, a, b, c, d, W, i + 4), \
+					 S2(d, e, f, g, h, a, b, c, W, i + 5), \
+					 S2(c, d, e, f, g, h, a, b, W, i + 6), \
+					 S2(b, c, d, e, f, g, h, a, W, i + 7))
+
+/*
+ * add another 512 bit block to the message digest
+ */
+static void hash_sha256_block(Uint *ABCDEFGH, char *block)
+{
+    static const Uint K[] = {
+	0x428a2f98L, 0x71374491L, 0xb5c0fbcfL, 0xe9b5dba5L, 0x3956c25bL,
+	0x59f111f1L, 0x923f82a4L, 0xab1c5ed5L, 0xd807aa98L, 0x12835b01L,
+	0x243185beL, 0x550c7dc3L, 0x72be5d74L, 0x80deb1feL, 0x9bdc06a7L,
+	0xc19bf174L, 0xe49b69c1L, 0xefbe4786L, 0x0fc19dc6L, 0x240ca1ccL,
+	0x2de92c6fL, 0x4a7484aaL, 0x5cb0a9dcL, 0x76f988daL, 0x983e5152L,
+	0xa831c66dL, 0xb00327c8L, 0xbf597fc7L, 0xc6e00bf3L, 0xd5a79147L,
+	0x06ca6351L, 0x14292967L, 0x27b70a85L, 0x2e1b2138L, 0x4d2c6dfcL,
+	0x53380d13L, 0x650a7354L, 0x766a0abbL, 0x81c2c92eL, 0x92722c85L,
+	0xa2bfe8a1L, 0xa81a664bL, 0xc24b8b70L, 0xc76c51a3L, 0xd192e819L,
+	0xd6990624L, 0xf40e3585L, 0x106aa070L, 0x19a4c116L, 0x1e376c08L,
+	0x2748774cL, 0x34b0bcb5L, 0x391c0cb3L, 0x4ed8aa4aL, 0x5b9cca4fL,
+	0x682e6ff3L, 0x748f82eeL, 0x78a5636fL, 0x84c87814L, 0x8cc70208L,
+	0x90befffaL, 0xa4506cebL, 0xbef9a3f7L, 0xc67178f2L
+    };
+    Uint W[16];
+    int i, j;
+    Uint a, b, c, d, e, f, g, h;
+
+    for (i = j = 0; i < 16; i++, j += 4) {
+       W[i] = (UCHAR(block[j + 0]) << 24) | (UCHAR(block[j + 1]) << 16) |
+	      (UCHAR(block[j + 2]) << 8) | UCHAR(block[j + 3]);
     }
-    memset(buffer + bufsz, '\0', 64 - bufsz);
-    buffer[59] = length >> 29;
-    buffer[60] = length >> 21;
-    buffer[61] = length >> 13;
-    buffer[62] = length >> 5;
-    buffer[63] = length << 3;
-    hash_sha1_block(digest, buffer);
-
-    for (bufsz = i = 0; i < 5; bufsz += 4, i++) {
-	buffer[bufsz + 0] = digest[i] >> 24;
-	buffer[bufsz + 1] = digest[i] >> 16;
-	buffer[bufsz + 2] = digest[i] >> 8;
-	buffer[bufsz + 3] = digest[i];
+
+    a = ABCDEFGH[0];
+    b = ABCDEFGH[1];
+    c = ABCDEFGH[2];
+    d = ABCDEFGH[3];
+    e = ABCDEFGH[4];
+    f = ABCDEFGH[5];
+    g = ABCDEFGH[6];
+    h = ABCDEFGH[7];
+
+    /*
+     * 8 rounds at a time, after which the variables are back in place;
+     * the message schedule is expanded in place, 16 words at a time
+     */
+    S8(W3, 0);
+    S8(W3, 8);
+    for (i = 16; i < 64; i += 8) {
+	S8(W4, i);
     }
-    return String::create(buffer, 20);
+
+    ABCDEFGH[0] += a;
+    ABCDEFGH[1] += b;
+    ABCDEFGH[2] += c;
+    ABCDEFGH[3] += d;
+    ABCDEFGH[4] += e;
+    ABCDEFGH[5] += f;
+    ABCDEFGH[6] += g;
+    ABCDEFGH[7] += h;
+}
+
+/*
+ * finish up SHA-256 hash
+ */
+static void hash_sha256_value(Value *val, Uint *digest, char *buffer,
+			      unsigned int bufsz, Uuint length)
+{
+    String *str;
+
+    hash_pad(digest, buffer, bufsz, length, TRUE, &hash_sha256_block);
+    hash_digest(buffer, digest, 8);
+    str = String::create(buffer, 32);
+    PUT_STRVAL_NOREF(val, str);
 }
 
+/*
+ * CRC-32 in 512 bit blocks, for incremental hashing
+ */
+static void hash_crc32_start(Uint *digest)
+{
+    digest[0] = 0xffffffffL;
+}
+
+/*
+ * add another 512 bit block to the CRC
+ */
+static void hash_crc32_block(Uint *crc, char *block)
+{
+    *crc = hash_crc32(*crc, block, 64);
+}
+
+/*
+ * finish up CRC-32, and return it as an integer
+ */
+static void hash_crc32_value(Value *val, Uint *crc, char *buffer,
+			     unsigned int bufsz, Uuint length)
+{
+    UNREFERENCED_PARAMETER(length);
+
+    PUT_INTVAL(val, hash_crc32(*crc, buffer, bufsz) ^ 0xffffffffL);
+}
+
+struct HashFunc {
+    const char *name;			/* algorithm name */
+    int nwords;				/* # digest words */
+    void (*start) (Uint*);		/* initialize digest */
+    void (*block) (Uint*, char*);	/* digest a 512 bit block */
+    void (*end) (Value*, Uint*, char*, unsigned int, Uuint); /* finish */
+};
+
+# define HF_CRC32	0
+# define HF_MD5		1
+# define HF_SHA1	2
+# define HF_SHA256	3
+# define NHASHFUNCS	4
+
+static HashFunc hashfuncs[NHASHFUNCS] = {
+    { "CRC32", 1, &hash_crc32_start, &hash_crc32_block, &hash_crc32_value },
+    { "MD5", 4, &hash_md5_start, &hash_md5_block, &hash_md5_value },
+    { "SHA1", 5, &hash_sha1_start, &hash_sha1_block, &hash_sha1_value },
+    { "SHA256", 8, &hash_sha256_start, &hash_sha256_block,
+      &hash_sha256_value }
+};
+
 /*
  * hash string blocks with a given function
  */
@@ -1316,7 +1682,7 @@ static Uint hash_blocks(Frame *f, int nargs, Uint *digest, char *buffer,
     Uint length;
 
     length = 0;
-    bufsz = 0;
+    bufsz = *bufsize;
     while (--nargs >= 0) {
 	len = f->sp[nargs].string->len;
 	if (len != 0) {
@@ -1360,58 +1726,65 @@ static Uint hash_blocks(Frame *f, int nargs, Uint *digest, char *buffer,
 }
 
 /*
- * compute MD5 hash
+ * compute the cost of hashing strings
  */
-void kf_md5(Frame *f, int nargs, Value *val)
+static Int hash_cost(Frame *f, int nargs)
 {
-    char buffer[64];
-    Uint digest[5];
     Int cost;
-    int i;
-    Uint length;
-    unsigned short bufsz;
-    String *str;
 
     cost = 3 * nargs + 64;
-    for (i = nargs; i > 0; ) {
-	cost += f->sp[--i].string->len;
-    }
-    if (!f->rlim->noticks && f->rlim->ticks <= cost) {
-	f->rlim->ticks = 0;
-	ext_runtime_error(f, "Out of ticks");
+    while (--nargs >= 0) {
+	cost += f->sp[nargs].string->len;
     }
-    i_add_ticks(f, cost);
-
-    hash_md5_start(digest);
-    length = hash_blocks(f, nargs, digest, buffer, &bufsz, 64, &hash_md5_block);
-    hash_md5_end(buffer, digest, buffer, bufsz, length);
-    str = String::create(buffer, 16);
-    PUT_STRVAL_NOREF(val, str);
+    return cost;
 }
 
 /*
- * compute SHA1 hash
+ * hash strings in one go
  */
-void kf_sha1(Frame *f, int nargs, Value *val)
+static void hash_message(Frame *f, int nargs, Value *val, HashFunc *hf)
 {
     char buffer[64];
-    Uint digest[5];
+    Uint digest[8];
     Int cost;
     Uint length;
     unsigned short bufsz;
-    String *str;
 
-    cost = hash_sha1_start(f, nargs, digest);
+    cost = hash_cost(f, nargs);
     if (!f->rlim->noticks && f->rlim->ticks <= cost) {
 	f->rlim->ticks = 0;
 	ext_runtime_error(f, "Out of ticks");
     }
     i_add_ticks(f, cost);
 
-    length = hash_blocks(f, nargs, digest, buffer, &bufsz, 64,
-			 &hash_sha1_block);
-    str = hash_sha1_end(digest, buffer, bufsz, length);
-    PUT_STRVAL_NOREF(val, str);
+    (hf->start)(digest);
+    bufsz = 0;
+    length = hash_blocks(f, nargs, digest, buffer, &bufsz, 64, hf->block);
+    (hf->end)(val, digest, buffer, bufsz, length);
+}
+
+/*
+ * compute MD5 hash
+ */
+void kf_md5(Frame *f, int nargs, Value *val)
+{
+    hash_message(f, nargs, val, &hashfuncs[HF_MD5]);
+}
+
+/*
+ * compute SHA1 hash
+ */
+void kf_sha1(Frame *f, int nargs, Value *val)
+{
+    hash_message(f, nargs, val, &hashfuncs[HF_SHA1]);
+}
+
+/*
+ * compute SHA256 hash
+ */
+void kf_sha256(Frame *f, int nargs, Value *val)
+{
+    hash_message(f, nargs, val, &hashfuncs[HF_SHA256]);
 }
 
 /*
@@ -1436,6 +1809,134 @@ int kf_hash_string(Frame *f, int nargs, KFun *func)
 }
 # endif
 
+# ifdef FUNCDEF
+FUNCDEF("hash_final", kf_hash_final, pt_hash_final, 0)
+FUNCDEF("hash_update", kf_hash_update, pt_hash_update, 0)
+# else
+char pt_hash_update[] = { C_TYPECHECKED | C_STATIC | C_ELLIPSIS, 1, 1, 0, 8,
+			  T_STRING, T_STRING, T_STRING };
+char pt_hash_final[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_MIXED,
+			 T_STRING };
+
+/*
+ * A hash context is a string that starts with a nil character, followed
+ * by the algorithm, the message length so far, the digest and the
+ * partial block.
+ */
+# define HCTX_HEADER	10
+
+/*
+ * start a hash, or continue one from a hash context
+ */
+static HashFunc *hash_context(String *str, Uint *digest, char *buffer,
+			      unsigned short *bufsz, Uuint *length)
+{
+    HashFunc *hf;
+    char *p;
+    int i;
+
+    p = str->text;
+    if (str->len == 0 || p[0] != '\0') {
+	/*
+	 * new hash
+	 */
+	for (hf = hashfuncs, i = NHASHFUNCS; i > 0; hf++, --i) {
+	    if (strlen(hf->name) == str->len && strcmp(hf->name, p) == 0) {
+		(hf->start)(digest);
+		*bufsz = 0;
+		*length = 0;
+		return hf;
+	    }
+	}
+	error("Unknown hash algorithm");
+    }
+
+    if (str->len < HCTX_HEADER || UCHAR(p[1]) >= NHASHFUNCS) {
+	error("Bad hash context");
+    }
+    hf = &hashfuncs[UCHAR(p[1])];
+    p += 2;
+    *length = 0;
+    for (i = 8; i > 0; --i) {
+	*length = (*length << 8) | UCHAR(*p++);
+    }
+    *bufsz = *length & 63;
+    if (str->len != HCTX_HEADER + hf->nwords * 4 + *bufsz) {
+	error("Bad hash context");
+    }
+    for (i = 0; i < hf->nwords; i++, p += 4) {
+	digest[i] = (UCHAR(p[0]) << 24) | (UCHAR(p[1]) << 16) |
+		    (UCHAR(p[2]) << 8) | UCHAR(p[3]);
+    }
+    memcpy(buffer, p, *bufsz);
+
+    return hf;
+}
+
+/*
+ * update a hash with strings
+ */
+int kf_hash_update(Frame *f, int nargs, KFun *kf)
+{
+    char buffer[64];
+    Uint digest[8];
+    Uuint length;
+    unsigned short bufsz;
+    HashFunc *hf;
+    String *str;
+    char *p;
+    int i;
+
+    UNREFERENCED_PARAMETER(kf);
+
+    hf = hash_context(f->sp[nargs - 1].string, digest, buffer, &bufsz,
+		      &length);
+    ext_runtime_check(f, hash_cost(f, nargs - 1));
+
+    length += hash_blocks(f, nargs - 1, digest, buffer, &bufsz, 64,
+			  hf->block);
+
+    /* save the new context */
+    str = String::create((char *) NULL, HCTX_HEADER + hf->nwords * 4 + bufsz);
+    p = str->text;
+    *p++ = '\0';
+    *p++ = hf - hashfuncs;
+    for (i = 56; i >= 0; i -= 8) {
+	*p++ = length >> i;
+    }
+    hash_digest(p, digest, hf->nwords);
+    memcpy(p + hf->nwords * 4, buffer, bufsz);
+
+    f->pop(nargs);
+    PUSH_STRVAL(f, str);
+    return 0;
+}
+
+/*
+ * finish a hash
+ */
+int kf_hash_final(Frame *f, int n, KFun *kf)
+{
+    char buffer[64];
+    Uint digest[8];
+    Uuint length;
+    unsigned short bufsz;
+    HashFunc *hf;
+    Value val;
+
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    hf = hash_context(f->sp->string, digest, buffer, &bufsz, &length);
+    i_add_ticks(f, 64);
+    (hf->end)(&val, digest, buffer, bufsz, length);
+    val.ref();
+    f->sp->string->del();
+    *f->sp = val;
+    return 0;
+}
+# endif
+
 
 # ifdef FUNCDEF
 FUNCDEF("crypt", kf_crypt, pt_crypt, 0)
@@ -23,6 +23,290 @@
 # include "kfun.h"
 # include "path.h"
 # include "editor.h"
+
+struct FileExtent {
+    char file[STRINGSZ];	/* file name */
+    ino_t ino;			/* file inode number */
+    time_t mtime;		/* file modification time */
+    time_t ctime;		/* file status change time */
+    off_t fsize;		/* file size */
+    off_t offset;		/* offset argument to read_file() */
+    Int size;			/* size argument to read_file() */
+    Uint stamp;			/* time of last use */
+    char *text;			/* text read, or NULL */
+    ssizet len;			/* length of text */
+};
+
+static FileExtent fcache[FILECACHESZ];	/* recently read file extents */
+static Uint fcstamp;			/* last use stamp */
+
+/*
+ * find a recently read file extent
+ */
+static FileExtent *fc_find(const char *file, struct stat *sbuf, off_t offset,
+			   Int size)
+{
+    FileExtent *fe;
+    int i;
+
+    for (fe = fcache, i = FILECACHESZ; i > 0; fe++, --i) {
+	if (fe->text != (char *) NULL && fe->mtime == sbuf->st_mtime &&
+	    fe->ctime == sbuf->st_ctime && fe->ino == sbuf->st_ino &&
+	    fe->fsize == sbuf->st_size && fe->offset == offset &&
+	    fe->size == size && strcmp(fe->file, file) == 0) {
+	    fe->stamp = ++fcstamp;
+	    return fe;
+	}
+    }
+    return (FileExtent *) NULL;
+}
+
+/*
+ * remember a file extent, replacing the least recently used one
+ */
+static void fc_put(const char *file, struct stat *sbuf, off_t offset,
+		   Int size, String *str)
+{
+    FileExtent *fe, *lru;
+    int i;
+
+    for (lru = fe = fcache, i = FILECACHESZ; i > 0; fe++, --i) {
+	if (fe->text == (char *) NULL) {
+	    lru = fe;
+	    break;
+	}
+	if (fe->stamp < lru->stamp) {
+	    lru = fe;
+	}
+    }
+    if (lru->text != (char *) NULL) {
+	FREE(lru->text);
+    }
+    strcpy(lru->file, file);
+    lru->ino = sbuf->st_ino;
+    lru->mtime = sbuf->st_mtime;
+    lru->ctime = sbuf->st_ctime;
+    lru->fsize = sbuf->st_size;
+    lru->offset = offset;
+    lru->size = size;
+    lru->stamp = ++fcstamp;
+    Alloc::staticMode();
+    lru->text = ALLOC(char, str->len + 1);
+    Alloc::dynamicMode();
+    memcpy(lru->text, str->text, str->len);
+    lru->len = str->len;
+}
+
+/*
+ * forget the extents read from a file, or all extents if file is NULL
+ */
+static void fc_remove(const char *file)
+{
+    FileExtent *fe;
+    int i;
+
+    for (fe = fcache, i = FILECACHESZ; i > 0; fe++, --i) {
+	if (fe->text != (char *) NULL &&
+	    (file == (char *) NULL || strcmp(fe->file, file) == 0)) {
+	    FREE(fe->text);
+	    fe->text = (char *) NULL;
+	}
+    }
+}
+
+struct DirEntry {
+    char *name;			/* file name */
+    Int size;			/* file size, -2 for a directory, or DE_* */
+    Int time;			/* file modification time */
+};
+
+# define DE_UNKNOWN	-3	/* size and time not yet known */
+# define DE_GONE	-4	/* entry no longer exists */
+
+struct DirListing {
+    char dir[STRINGSZ];		/* directory name */
+    time_t mtime;		/* directory modification time */
+    Uint stamp;			/* time of last use */
+    unsigned int nfiles;	/* # entries */
+    DirEntry *files;		/* entries sorted by name, or NULL */
+    char *names;		/* entry names */
+};
+
+static DirListing dcache[DIRCACHESZ];	/* recently listed directories */
+static Uint dcstamp;			/* last use stamp */
+
+static int dc_cmp (cvoid*, cvoid*);
+
+/*
+ * compare two directory entries
+ */
+static int dc_cmp(cvoid *cv1, cvoid *cv2)
+{
+    return strcmp(((DirEntry *) cv1)->name, ((DirEntry *) cv2)->name);
+}
+
+/*
+ * forget a directory listing
+ */
+static void dc_clear(DirListing *dl)
+{
+    FREE(dl->files);
+    FREE(dl->names);
+    dl->files = (DirEntry *) NULL;
+}
+
+/*
+ * get a directory listing.  The size and time of an entry are looked up
+ * by dc_stat() when first needed
+ */
+static DirListing *dc_list(const char *dir)
+{
+    struct stat sbuf;
+    DirListing *dl, *lru;
+    DirEntry *de;
+    char *file, *buf, *p;
+    unsigned int nfiles, bufsz, size, len, i;
+
+    if (P_stat(dir, &sbuf) < 0 || (sbuf.st_mode & S_IFMT) != S_IFDIR) {
+	return (DirListing *) NULL;
+    }
+    for (lru = dl = dcache, i = DIRCACHESZ; i > 0; dl++, --i) {
+	if (dl->files != (DirEntry *) NULL && strcmp(dl->dir, dir) == 0) {
+	    if (dl->mtime == sbuf.st_mtime) {
+		/* entries not added or removed since */
+		dl->stamp = ++dcstamp;
+		return dl;
+	    }
+	    lru = dl;	/* outdated */
+	    break;
+	}
+	if (dl->files == (DirEntry *) NULL) {
+	    if (lru->files != (DirEntry *) NULL) {
+		lru = dl;
+	    }
+	} else if (lru->files != (DirEntry *) NULL && dl->stamp < lru->stamp) {
+	    lru = dl;
+	}
+    }
+
+    if (!P_opendir(dir)) {
+	return (DirListing *) NULL;
+    }
+    buf = ALLOC(char, bufsz = 4096);
+    size = nfiles = 0;
+    while ((file=P_readdir()) != (char *) NULL) {
+	if (nfiles == DIRCACHEMAX) {
+	    /* too large to remember */
+	    P_closedir();
+	    FREE(buf);
+	    return (DirListing *) NULL;
+	}
+	len = strlen(file) + 1;
+	if (size + len > bufsz) {
+	    do {
+		bufsz <<= 1;
+	    } while (size + len > bufsz);
+	    p = ALLOC(char, bufsz);
+	    memcpy(p, buf, size);
+	    FREE(buf);
+	    buf = p;
+	}
+	memcpy(buf + size, file, len);
+	size += len;
+	nfiles++;
+    }
+    P_closedir();
+
+    if (lru->files != (DirEntry *) NULL) {
+	dc_clear(lru);
+    }
+    strcpy(lru->dir, dir);
+    lru->mtime = sbuf.st_mtime;
+    if (lru->mtime >= (time_t) P_time()) {
+	/* may still change within the same second */
+	lru->mtime = (time_t) -1;
+    }
+    lru->stamp = ++dcstamp;
+    Alloc::staticMode();
+    lru->files = ALLOC(DirEntry, nfiles + 1);
+    lru->names = ALLOC(char, size + 1);
+    Alloc::dynamicMode();
+    memcpy(lru->names, buf, size);
+    FREE(buf);
+
+    for (de = lru->files, file = lru->names, i = nfiles; i > 0;
+	 de++, file += strlen(file) + 1, --i) {
+	de->name = file;
+	de->size = DE_UNKNOWN;
+    }
+    lru->nfiles = nfiles;
+    std::qsort(lru->files, nfiles, sizeof(DirEntry), dc_cmp);
+
+    return lru;
+}
+
+/*
+ * get the size and time of an entry in a directory listing, if not
+ * known yet.  Return FALSE if the entry no longer exists
+ */
+static bool dc_stat(DirListing *dl, DirEntry *de)
+{
+    struct stat sbuf;
+    char *path;
+    unsigned int dirlen, len;
+
+    if (de->size == DE_UNKNOWN) {
+	dirlen = (strcmp(dl->dir, ".") == 0) ? 0 : strlen(dl->dir) + 1;
+	len = strlen(de->name) + 1;
+	path = ALLOCA(char, dirlen + len);
+	if (dirlen != 0) {
+	    memcpy(path, dl->dir, dirlen - 1);
+	    path[dirlen - 1] = '/';
+	}
+	memcpy(path + dirlen, de->name, len);
+	if (P_stat(path, &sbuf) < 0) {
+	    de->size = DE_GONE;
+	} else {
+	    if ((sbuf.st_mode & S_IFMT) == S_IFDIR) {
+		de->size = -2;	/* special value for directory */
+	    } else {
+		de->size = sbuf.st_size;
+	    }
+	    de->time = sbuf.st_mtime;
+	}
+	AFREE(path);
+    }
+    return (de->size != DE_GONE);
+}
+
+/*
+ * forget the listing of the directory a file is in, or all listings if
+ * file is NULL
+ */
+static void dc_remove(const char *file)
+{
+    DirListing *dl;
+    const char *p;
+    int i, len;
+
+    len = 0;
+    if (file != (char *) NULL) {
+	p = strrchr(file, '/');
+	if (p == (char *) NULL) {
+	    file = ".";
+	    len = 1;
+	} else {
+	    len = p - file;
+	}
+    }
+    for (dl = dcache, i = DIRCACHESZ; i > 0; dl++, --i) {
+	if (dl->files != (DirEntry *) NULL &&
+	    (file == (char *) NULL ||
+	     (strncmp(dl->dir, file, len) == 0 && dl->dir[len] == '\0'))) {
+	    dc_clear(dl);
+	}
+    }
+}
 # endif
 
 # ifdef FUNCDEF
@@ -60,6 +344,8 @@ int kf_editor(Frame *f, int nargs, KFun *kf)
 	*--f->sp = Value::nil;
     } else {
 	str = Editor::command(obj, f->sp->string->text);
+	fc_remove((char *) NULL);	/* the editor may have written a file */
+	dc_remove((char *) NULL);
 	f->sp->string->del();
 	if (str != (String *) NULL) {
 	    PUT_STR(f->sp, str);
@@ -361,6 +647,155 @@ static void save_mapping(savecontext *x, Array *a)
     put(x, "])", 2);
 }
 
+/*
+ * The binary save format starts with SAVEMAGIC, followed by the name of
+ * each variable saved, prefixed with its length, and its value.  Numbers
+ * are stored in 7-bit groups, least significant first, and integers are
+ * zigzag encoded to keep small negative numbers small.
+ */
+# define SAVEMAGIC	"\0DGDSAVE"
+# define SAVEMAGICSZ	8
+
+# define SV_NIL		0	/* nil */
+# define SV_INT		1	/* integer */
+# define SV_FLOAT	2	/* float: high word, low longword */
+# define SV_STRING	3	/* length, text */
+# define SV_ARRAY	4	/* size, elements */
+# define SV_MAPPING	5	/* # pairs, indices and values */
+# define SV_AREF	6	/* index of previously saved array */
+# define SV_MREF	7	/* index of previously saved mapping */
+
+/*
+ * output a number in binary format
+ */
+static void bsave_number(savecontext *x, Uint n)
+{
+    char buf[5];
+    unsigned int len;
+
+    for (len = 0; n >= 0x80; n >>= 7) {
+	buf[len++] = (n & 0x7f) | 0x80;
+    }
+    buf[len++] = n;
+    put(x, buf, len);
+}
+
+static void bsave_array (savecontext*, Array*, bool);
+
+/*
+ * save a value in binary format
+ */
+static void bsave_value(savecontext *x, Value *v)
+{
+    char buf[7];
+    Float flt;
+
+    switch (v->type) {
+    case T_NIL:
+	buf[0] = SV_NIL;
+	put(x, buf, 1);
+	break;
+
+    case T_INT:
+	buf[0] = SV_INT;
+	put(x, buf, 1);
+	bsave_number(x, ((Uint) v->number << 1) ^ (Uint) (v->number >> 31));
+	break;
+
+    case T_FLOAT:
+	GET_FLT(v, flt);
+	buf[0] = SV_FLOAT;
+	buf[1] = flt.high >> 8;
+	buf[2] = flt.high;
+	buf[3] = flt.low >> 24;
+	buf[4] = flt.low >> 16;
+	buf[5] = flt.low >> 8;
+	buf[6] = flt.low;
+	put(x, buf, 7);
+	break;
+
+    case T_STRING:
+	buf[0] = SV_STRING;
+	put(x, buf, 1);
+	bsave_number(x, v->string->len);
+	put(x, v->string->text, v->string->len);
+	break;
+
+    case T_OBJECT:
+    case T_LWOBJECT:
+	if (Config::typechecking() >= 2) {
+	    buf[0] = SV_NIL;
+	    put(x, buf, 1);
+	} else {
+	    buf[0] = SV_INT;
+	    buf[1] = 0;
+	    put(x, buf, 2);
+	}
+	break;
+
+    case T_ARRAY:
+	bsave_array(x, v->array, FALSE);
+	break;
+
+    case T_MAPPING:
+	bsave_array(x, v->array, TRUE);
+	break;
+    }
+}
+
+/*
+ * save an array or mapping in binary format
+ */
+static void bsave_array(savecontext *x, Array *a, bool map)
+{
+    char tag;
+    Uint i;
+    uindex n;
+    Value *v;
+
+    i = a->put(x->narrays);
+    if (i < x->narrays) {
+	/* same as some previous array or mapping */
+	tag = (map) ? SV_MREF : SV_AREF;
+	put(x, &tag, 1);
+	bsave_number(x, i);
+	return;
+    }
+    x->narrays++;
+
+    if (map) {
+	a->mapCompact(a->primary->data);
+
+	/*
+	 * skip index/value pairs of which either is an object
+	 */
+	for (i = n = a->size >> 1, v = Dataspace::elts(a); i > 0;
+	     --i, v += 2) {
+	    if (v[0].type == T_OBJECT || v[0].type == T_LWOBJECT ||
+		v[1].type == T_OBJECT || v[1].type == T_LWOBJECT) {
+		--n;
+	    }
+	}
+	tag = SV_MAPPING;
+	put(x, &tag, 1);
+	bsave_number(x, n);
+	for (i = a->size >> 1, v = a->elts; i > 0; --i, v += 2) {
+	    if (v[0].type != T_OBJECT && v[0].type != T_LWOBJECT &&
+		v[1].type != T_OBJECT && v[1].type != T_LWOBJECT) {
+		bsave_value(x, &v[0]);
+		bsave_value(x, &v[1]);
+	    }
+	}
+    } else {
+	tag = SV_ARRAY;
+	put(x, &tag, 1);
+	bsave_number(x, a->size);
+	for (i = a->size, v = Dataspace::elts(a); i > 0; --i, v++) {
+	    bsave_value(x, v);
+	}
+    }
+}
+
 char pt_save_object[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_VOID,
 			  T_STRING };
 
@@ -379,6 +814,7 @@ int kf_save_object(Frame *f, int n, KFun *kf)
     char file[STRINGSZ], buf[18], tmp[STRINGSZ + 8], *_tmp;
     savecontext x;
     Float flt;
+    bool binary;
 
     UNREFERENCED_PARAMETER(n);
     UNREFERENCED_PARAMETER(kf);
@@ -406,6 +842,10 @@ int kf_save_object(Frame *f, int n, KFun *kf)
     }
     x.buffer = ALLOCA(char, BUF_SIZE);
     x.bufsz = 0;
+    binary = Config::saveBinary();
+    if (binary) {
+	put(&x, SAVEMAGIC, SAVEMAGICSZ);
+    }
 
     ctrl = f->ctrl;
     Array::merge();
@@ -436,6 +876,14 @@ int kf_save_object(Frame *f, int n, KFun *kf)
 		     * don't save object values, nil or 0
 		     */
 		    str = ctrl->strconst(v->inherit, v->index);
+		    if (binary) {
+			bsave_number(&x, str->len);
+			put(&x, str->text, str->len);
+			bsave_value(&x, var);
+			var++;
+			nvars++;
+			continue;
+		    }
 		    put(&x, str->text, str->len);
 		    put(&x, " ", 1);
 		    switch (var->type) {
@@ -483,6 +931,8 @@ int kf_save_object(Frame *f, int n, KFun *kf)
     AFREE(x.buffer);
 
     P_unlink(file);
+    fc_remove(file);
+    dc_remove(file);
     if (P_rename(tmp, file) < 0) {
 	P_unlink(tmp);
 	error("Cannot rename temporary save file to \"/%s\"", file);
@@ -537,6 +987,11 @@ struct restcontext {
     vchunk alist;		/* list of array value chunks */
     Uint narrays;		/* # of arrays/mappings */
     char file[STRINGSZ];	/* current restore file */
+    int fd;			/* binary save file descriptor */
+    char *buffer;		/* binary save file buffer */
+    char *bufp;			/* next in binary save file buffer */
+    unsigned int bufsz;		/* # bytes left in buffer */
+    off_t left;			/* # bytes left in file, after the buffer */
 };
 
 /*
@@ -856,6 +1311,309 @@ static char *restore_value(restcontext *x, char *buf, Value *val)
     }
 }
 
+/*
+ * refill the buffer from a binary save file.  Return FALSE at the end of
+ * the file
+ */
+static bool bfill(restcontext *x)
+{
+    int n;
+
+    n = P_read(x->fd, x->buffer, BUF_SIZE);
+    if (n <= 0) {
+	return FALSE;
+    }
+    x->left -= n;
+    x->bufp = x->buffer;
+    x->bufsz = n;
+    return TRUE;
+}
+
+/*
+ * get a number of bytes from a binary save file
+ */
+static void bget(restcontext *x, char *buf, Uint len)
+{
+    while (len > x->bufsz) {
+	memcpy(buf, x->bufp, x->bufsz);
+	buf += x->bufsz;
+	len -= x->bufsz;
+	x->bufsz = 0;
+	if (len >= BUF_SIZE) {
+	    /* read large chunks directly */
+	    if (P_read(x->fd, buf, len) != (int) len) {
+		restore_error(x, "unexpected end of file");
+	    }
+	    x->left -= len;
+	    return;
+	}
+	if (!bfill(x)) {
+	    restore_error(x, "unexpected end of file");
+	}
+    }
+    memcpy(buf, x->bufp, len);
+    x->bufp += len;
+    x->bufsz -= len;
+}
+
+/*
+ * get a number from a binary save file
+ */
+static Uint bget_number(restcontext *x)
+{
+    Uint n;
+    int shift;
+    char c;
+
+    n = 0;
+    shift = 0;
+    do {
+	if (shift > 28) {
+	    restore_error(x, "number too large");
+	}
+	if (x->bufsz == 0 && !bfill(x)) {
+	    restore_error(x, "unexpected end of file");
+	}
+	c = *x->bufp++;
+	--x->bufsz;
+	n |= (Uint) (c & 0x7f) << shift;
+	shift += 7;
+    } while (c & 0x80);
+
+    return n;
+}
+
+/*
+ * restore a value from a binary save file
+ */
+static void brestore_value(restcontext *x, Value *val)
+{
+    char buf[6], tag;
+    Uint n;
+    Float flt;
+    String *str;
+    Value *v;
+    Array *a;
+
+    if (x->bufsz == 0 && !bfill(x)) {
+	restore_error(x, "unexpected end of file");
+    }
+    --x->bufsz;
+    switch (tag = *x->bufp++) {
+    case SV_NIL:
+	*val = Value::nil;
+	break;
+
+    case SV_INT:
+	n = bget_number(x);
+	PUT_INTVAL(val, (Int) (n >> 1) ^ -(Int) (n & 1));
+	break;
+
+    case SV_FLOAT:
+	bget(x, buf, 6);
+	flt.high = (UCHAR(buf[0]) << 8) | UCHAR(buf[1]);
+	if ((flt.high & 0x7ff0) == 0x7ff0) {
+	    restore_error(x, "illegal exponent");
+	}
+	flt.low = ((Uint) UCHAR(buf[2]) << 24) | (UCHAR(buf[3]) << 16) |
+		  (UCHAR(buf[4]) << 8) | UCHAR(buf[5]);
+	PUT_FLTVAL(val, flt);
+	break;
+
+    case SV_STRING:
+	n = bget_number(x);
+	if (n > x->bufsz + x->left) {
+	    /* don't allocate more than the file can hold */
+	    restore_error(x, "unexpected end of file");
+	}
+	if (n <= x->bufsz) {
+	    /* entirely in the buffer */
+	    str = String::create(x->bufp, n);
+	    x->bufp += n;
+	    x->bufsz -= n;
+	} else {
+	    str = String::create((char *) NULL, n);
+	    try {
+		ErrorContext::push();
+		bget(x, str->text, n);
+		ErrorContext::pop();
+	    } catch (...) {
+		str->ref();
+		str->del();
+		error((char *) NULL);	/* pass on the error */
+	    }
+	}
+	PUT_STRVAL_NOREF(val, str);
+	break;
+
+    case SV_ARRAY:
+    case SV_MAPPING:
+	n = bget_number(x);
+	if (tag == SV_ARRAY) {
+	    ac_put(x, T_ARRAY, a = Array::create(x->f->data, n));
+	} else {
+	    ac_put(x, T_MAPPING,
+		   a = Array::mapCreate(x->f->data, (long) n << 1));
+	}
+	for (n = a->size, v = a->elts; n > 0; --n) {
+	    *v++ = Value::nil;
+	}
+	try {
+	    ErrorContext::push();
+	    /* restore the values */
+	    for (n = a->size, v = a->elts; n > 0; --n) {
+		brestore_value(x, v);
+		(v++)->ref();
+	    }
+	    if (tag == SV_MAPPING) {
+		a->mapSort();
+	    }
+	    ErrorContext::pop();
+	} catch (...) {
+	    a->ref();
+	    a->del();
+	    error((char *) NULL);	/* pass on the error */
+	}
+	if (tag == SV_ARRAY) {
+	    PUT_ARRVAL_NOREF(val, a);
+	} else {
+	    PUT_MAPVAL_NOREF(val, a);
+	}
+	break;
+
+    case SV_AREF:
+	n = bget_number(x);
+	if (n >= x->narrays || ac_get(x, n)->type != T_ARRAY) {
+	    restore_error(x, "bad array reference");
+	}
+	*val = *ac_get(x, n);
+	break;
+
+    case SV_MREF:
+	n = bget_number(x);
+	if (n >= x->narrays || ac_get(x, n)->type != T_MAPPING) {
+	    restore_error(x, "bad mapping reference");
+	}
+	*val = *ac_get(x, n);
+	break;
+
+    default:
+	restore_error(x, "bad value");
+    }
+}
+
+struct restvar {
+    Value *var;			/* variable */
+    VarDef *def;		/* variable definition */
+    String *name;		/* variable name */
+};
+
+/*
+ * restore the variables of the current object from a binary save file
+ */
+static void brestore_vars(restcontext *x, Object *obj)
+{
+    Frame *f;
+    Control *ctrl;
+    Inherit *inh;
+    VarDef *v;
+    Value *var, tmp;
+    restvar *vars, *rv;
+    unsigned short i, j, n, nvars;
+    Uint len;
+    char name[STRINGSZ];
+
+    /*
+     * collect the non-static variables that can be restored
+     */
+    f = x->f;
+    ctrl = obj->control();
+    vars = rv = ALLOCA(restvar, ctrl->nvariables + 1);
+    if (f->lwobj != (Array *) NULL) {
+	var = &f->lwobj->elts[2];
+    } else {
+	var = f->data->variables;
+    }
+    nvars = 0;
+    for (i = ctrl->ninherits, inh = ctrl->inherits; i > 0; --i, inh++) {
+	if (inh->varoffset == nvars) {
+	    ctrl = OBJR(inh->oindex)->control();
+	    if (inh->priv) {
+		/* skip privately inherited variables */
+		var += ctrl->nvardefs;
+		nvars += ctrl->nvardefs;
+		continue;
+	    }
+	    for (j = ctrl->nvardefs, v = ctrl->vars(); j > 0; --j, v++) {
+		if (!(v->sclass & C_STATIC)) {
+		    rv->var = var;
+		    rv->def = v;
+		    rv->name = ctrl->strconst(v->inherit, v->index);
+		    rv++;
+		}
+		var++;
+		nvars++;
+	    }
+	}
+    }
+    n = rv - vars;
+
+    rv = vars;
+    try {
+	ErrorContext::push();
+	while (x->bufsz != 0 || bfill(x)) {
+	    len = bget_number(x);
+	    if (len == 0 || len >= STRINGSZ) {
+		restore_error(x, "bad variable name");
+	    }
+	    bget(x, name, len);
+	    brestore_value(x, &tmp);
+
+	    /*
+	     * look for the variable, starting after the previous one
+	     */
+	    for (j = n; j > 0; --j) {
+		if (rv->name->len == len &&
+		    memcmp(rv->name->text, name, len) == 0) {
+		    break;
+		}
+		if (++rv == vars + n) {
+		    rv = vars;
+		}
+	    }
+	    if (j == 0) {
+		/* the saved variable is not in this object */
+		tmp.ref();
+		tmp.del();
+	    } else {
+		v = rv->def;
+		if (v->type != tmp.type && v->type != T_MIXED &&
+		    Config::typechecking() &&
+		    (!VAL_NIL(&tmp) || !T_POINTER(v->type)) &&
+		    (tmp.type != T_ARRAY || (v->type & T_REF) == 0)) {
+		    tmp.ref();
+		    tmp.del();
+		    restore_error(x, "value has wrong type");
+		}
+		if (f->lwobj != (Array *) NULL) {
+		    f->data->assignElt(f->lwobj, rv->var, &tmp);
+		} else {
+		    f->data->assignVar(rv->var, &tmp);
+		}
+		if (++rv == vars + n) {
+		    rv = vars;
+		}
+	    }
+	    x->line++;
+	}
+	ErrorContext::pop();
+    } catch (...) {
+	AFREE(vars);
+	error((char *) NULL);	/* pass on error */
+    }
+    AFREE(vars);
+}
+
 char pt_restore_object[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_INT,
 			     T_STRING };
 
@@ -876,8 +1634,8 @@ int kf_restore_object(Frame *f, int n, KFun *kf)
     restcontext x;
     Object *obj;
     int fd;
-    char *buffer, *name;
-    bool onstack, pending;
+    char *buffer, *name, magic[SAVEMAGICSZ];
+    bool onstack, pending, binary;
 
     UNREFERENCED_PARAMETER(n);
     UNREFERENCED_PARAMETER(kf);
@@ -902,25 +1660,35 @@ int kf_restore_object(Frame *f, int n, KFun *kf)
 	P_close(fd);
 	return 0;
     }
-    buffer = ALLOCA(char, sbuf.st_size + 1);
-    if (buffer == (char *) NULL) {
-	buffer = ALLOC(char, sbuf.st_size + 1);
-	onstack = FALSE;
-    } else {
+    binary = (P_read(fd, magic, SAVEMAGICSZ) == SAVEMAGICSZ &&
+	      memcmp(magic, SAVEMAGIC, SAVEMAGICSZ) == 0);
+    if (binary) {
+	buffer = ALLOCA(char, BUF_SIZE);
 	onstack = TRUE;
-    }
-    if (P_read(fd, buffer, (unsigned int) sbuf.st_size) != sbuf.st_size) {
-	/* read failed (should never happen, but...) */
+    } else if (P_lseek(fd, 0, SEEK_SET) != 0) {
 	P_close(fd);
-	if (onstack) {
-	    AFREE(buffer);
+	return 0;
+    } else {
+	buffer = ALLOCA(char, sbuf.st_size + 1);
+	if (buffer == (char *) NULL) {
+	    buffer = ALLOC(char, sbuf.st_size + 1);
+	    onstack = FALSE;
 	} else {
-	    FREE(buffer);
+	    onstack = TRUE;
 	}
-	return 0;
+	if (P_read(fd, buffer, (unsigned int) sbuf.st_size) != sbuf.st_size) {
+	    /* read failed (should never happen, but...) */
+	    P_close(fd);
+	    if (onstack) {
+		AFREE(buffer);
+	    } else {
+		FREE(buffer);
+	    }
+	    return 0;
+	}
+	buffer[sbuf.st_size] = '\0';
+	P_close(fd);
     }
-    buffer[sbuf.st_size] = '\0';
-    P_close(fd);
 
     /*
      * First, reset all non-static variables that do not hold object values.
@@ -962,6 +1730,31 @@ int kf_restore_object(Frame *f, int n, KFun *kf)
     x.line = 1;
     x.f = f;
     x.narrays = 0;
+    if (binary) {
+	/*
+	 * binary save file, read as it is restored
+	 */
+	x.fd = fd;
+	x.buffer = buffer;
+	x.bufsz = 0;
+	x.left = sbuf.st_size - SAVEMAGICSZ;
+	try {
+	    ErrorContext::push();
+	    brestore_vars(&x, obj);
+	    ErrorContext::pop();
+	} catch (...) {
+	    x.alist.clean();
+	    P_close(fd);
+	    AFREE(buffer);
+	    error((char *) NULL);	/* pass on error */
+	}
+	x.alist.clean();
+	P_close(fd);
+	AFREE(buffer);
+	f->sp->number = 1;
+	return 0;
+    }
+
     buf = buffer;
     pending = FALSE;
     try {
@@ -1156,6 +1949,8 @@ int kf_write_file(Frame *f, int nargs, KFun *kf)
 	PUT_INT(&f->sp[1], 1);
     }
     P_close(fd);
+    fc_remove(file);
+    dc_remove(file);
 
     (f->sp++)->string->del();
     return 0;
@@ -1174,10 +1969,13 @@ char pt_read_file[] = { C_TYPECHECKED | C_STATIC, 1, 2, 0, 9, T_STRING,
  */
 int kf_read_file(Frame *f, int nargs, KFun *kf)
 {
-    char file[STRINGSZ], *buf;
-    struct stat sbuf;
-    off_t l;
-    Int size;
+    char file[STRINGSZ];
+    struct stat sbuf, fbuf;
+    off_t l, offset;
+    Int size, n;
+    FileExtent *fe;
+    String *str;
+    Uint now;
     static int fd;
 
     UNREFERENCED_PARAMETER(kf);
@@ -1204,6 +2002,17 @@ int kf_read_file(Frame *f, int nargs, KFun *kf)
 	return 3;
     }
     i_add_ticks(f, 1000);
+    if (P_stat(file, &sbuf) >= 0 && (sbuf.st_mode & S_IFMT) == S_IFREG) {
+	fe = fc_find(file, &sbuf, l, size);
+	if (fe != (FileExtent *) NULL) {
+	    /* read recently, and not changed since */
+	    i_add_ticks(f, 2 * fe->len);
+	    PUT_STRVAL(f->sp, String::create(fe->text, fe->len));
+	    return 0;
+	}
+    }
+
+    now = P_time();
     fd = P_open(file, O_RDONLY | O_BINARY, 0);
     if (fd < 0) {
 	/* cannot open file */
@@ -1215,6 +2024,8 @@ int kf_read_file(Frame *f, int nargs, KFun *kf)
 	P_close(fd);
 	return 0;
     }
+    fbuf = sbuf;
+    offset = l;
 
     if (l != 0) {
 	/*
@@ -1233,29 +2044,45 @@ int kf_read_file(Frame *f, int nargs, KFun *kf)
 	sbuf.st_size -= l;
     }
 
-    if (size == 0 || size > sbuf.st_size) {
-	size = sbuf.st_size;
+    n = size;
+    if (n == 0 || n > sbuf.st_size) {
+	n = sbuf.st_size;
     }
-    if (size > (Uint) MAX_STRLEN) {
+    if (n > (Uint) MAX_STRLEN) {
 	P_close(fd);
 	error("String too long");
     }
-    buf = (size != 0) ? ALLOC(char, size) : (char *) NULL;
-    if (size > 0 && (size=P_read(fd, buf, (unsigned int) size)) < 0) {
-	/* read failed */
-	P_close(fd);
-	if (buf != (char *) NULL) {
-	    FREE(buf);
+
+    /* read directly into the string */
+    str = String::create((char *) NULL, n);
+    if (n > 0 && (l = P_read(fd, str->text, (unsigned int) n)) != n) {
+	if (l < 0) {
+	    /* read failed */
+	    P_close(fd);
+	    str->ref();
+	    str->del();
+	    error("Read failed in read_file()");
 	}
-	error("Read failed in read_file()");
+	PUT_STRVAL(f->sp, String::create(str->text, l));
+	str->ref();
+	str->del();
+	P_close(fd);
+	i_add_ticks(f, 2 * l);
+	return 0;
     }
     P_close(fd);
-    i_add_ticks(f, 2 * size);
+    i_add_ticks(f, 2 * n);
 
-    PUT_STRVAL(f->sp, String::create((char *) buf, size));
-    if (buf != (char *) NULL) {
-	FREE(buf);
+    if ((sbuf.st_mode & S_IFMT) == S_IFREG && n <= FILECACHEMAX &&
+	fbuf.st_mtime < (time_t) now && fbuf.st_ctime < (time_t) now) {
+	/*
+	 * Timestamps are in seconds, so a file changed in the second that it
+	 * was read in may change again without the change showing.  Only
+	 * cache files that were last changed before that.
+	 */
+	fc_put(file, &fbuf, offset, size, str);
     }
+    PUT_STRVAL(f->sp, str);
 
     return 0;
 }
@@ -1292,6 +2119,8 @@ int kf_rename_file(Frame *f, int n, KFun *kf)
     f->sp->string->del();
     PUT_INTVAL(f->sp, (P_access(from, W_OK) >= 0 && P_access(to, F_OK) < 0 &&
 		       P_rename(from, to) >= 0));
+    fc_remove((char *) NULL);	/* may have been a directory */
+    dc_remove((char *) NULL);
     return 0;
 }
 # endif
@@ -1324,6 +2153,8 @@ int kf_remove_file(Frame *f, int n, KFun *kf)
     i_add_ticks(f, 1000);
     f->sp->string->del();
     PUT_INTVAL(f->sp, (P_access(file, W_OK) >= 0 && P_unlink(file) >= 0));
+    fc_remove(file);
+    dc_remove(file);
     return 0;
 }
 # endif
@@ -1355,6 +2186,7 @@ int kf_make_dir(Frame *f, int n, KFun *kf)
     i_add_ticks(f, 1000);
     f->sp->string->del();
     PUT_INTVAL(f->sp, (P_mkdir(file, 0775) >= 0));
+    dc_remove(file);
     return 0;
 }
 # endif
@@ -1387,6 +2219,7 @@ int kf_remove_dir(Frame *f, int n, KFun *kf)
     i_add_ticks(f, 1000);
     f->sp->string->del();
     PUT_INTVAL(f->sp, (P_rmdir(file) >= 0));
+    dc_remove((char *) NULL);
     return 0;
 }
 # endif
@@ -1570,6 +2403,9 @@ int kf_get_dir(Frame *f, int nargs, KFun *kf)
     char *file, *pat, buf[STRINGSZ], dirbuf[STRINGSZ];
     const char *dir;
     fileinfo finf;
+    DirListing *dl;
+    DirEntry *de;
+    bool sorted;
     Array *a;
 
     UNREFERENCED_PARAMETER(nargs);
@@ -1593,12 +2429,32 @@ int kf_get_dir(Frame *f, int nargs, KFun *kf)
 
     ftable = ALLOC(fileinfo, ftabsz = FILEINFO_CHUNK);
     nfiles = 0;
+    sorted = FALSE;
     if (strpbrk(pat, "?*[\\") == (char *) NULL &&
-	getinfo(file, pat, &ftable[0])) {
+	getinfo(dir, pat, &ftable[0])) {
 	/*
 	 * single file
 	 */
 	nfiles++;
+    } else if ((dl=dc_list(dir)) != (DirListing *) NULL) {
+	/*
+	 * select files from directory listing
+	 */
+	if (dl->nfiles > ftabsz) {
+	    FREE(ftable);
+	    ftable = ALLOC(fileinfo, ftabsz = dl->nfiles);
+	}
+	i = Config::arraySize();
+	for (de = dl->files; de < dl->files + dl->nfiles && nfiles < i; de++) {
+	    if (match(pat, de->name) > 0 && dc_stat(dl, de)) {
+		ftable[nfiles].name = String::create(de->name, strlen(de->name));
+		ftable[nfiles].name->ref();
+		ftable[nfiles].size = de->size;
+		ftable[nfiles].time = de->time;
+		nfiles++;
+	    }
+	}
+	sorted = TRUE;
     } else if (P_opendir(dir)) {
 	/*
 	 * read files from directory
@@ -1634,7 +2490,9 @@ int kf_get_dir(Frame *f, int nargs, KFun *kf)
     if (nfiles != 0) {
 	Value *n, *s, *t;
 
-	std::qsort(ftable, nfiles, sizeof(fileinfo), cmp);
+	if (!sorted) {
+	    std::qsort(ftable, nfiles, sizeof(fileinfo), cmp);
+	}
 	n = a->elts[0].array->elts;
 	s = a->elts[1].array->elts;
 	t = a->elts[2].array->elts;
@@ -572,3 +572,496 @@ int kf_tanh(Frame *f, int n, KFun *kf)
     return 0;
 }
 # endif
+
+
+# ifndef FUNCDEF
+/*
+ * return the type of an array that holds only ints or only floats,
+ * or T_NIL
+ */
+static int arr_type(Value *v, unsigned short size)
+{
+    int type;
+
+    if (size == 0) {
+	return T_INT;
+    }
+    type = v->type;
+    if (type != T_INT && type != T_FLOAT) {
+	return T_NIL;
+    }
+    while (--size != 0) {
+	if ((++v)->type != type) {
+	    return T_NIL;
+	}
+    }
+    return type;
+}
+
+# define FLTKEY_SIGN	((Uuint) 1 << 47)
+# define FLTKEY_MASK	(((Uuint) 1 << 48) - 1)
+
+/*
+ * map a float onto an unsigned key with the same ordering
+ */
+static Uuint arr_fltkey(Value *v)
+{
+    Uuint key;
+
+    key = ((Uuint) v->oindex << 32) | v->objcnt;
+    return (key & FLTKEY_SIGN) ? ~key & FLTKEY_MASK : key | FLTKEY_SIGN;
+}
+
+/*
+ * map a key back onto a float
+ */
+static void arr_keyflt(Uuint key, Float *flt)
+{
+    key = (key & FLTKEY_SIGN) ? key ^ FLTKEY_SIGN : ~key & FLTKEY_MASK;
+    flt->high = (unsigned short) (key >> 32);
+    flt->low = (Uint) key;
+}
+
+/*
+ * check two arrays for an element-wise operation, and return their type
+ */
+static int arr_pair(Frame *f, Value **v1, Value **v2)
+{
+    int type;
+    unsigned short size;
+
+    size = f->sp[1].array->size;
+    *v1 = Dataspace::elts(f->sp[1].array);
+    type = arr_type(*v1, size);
+    if (type == T_NIL) {
+	return -1;
+    }
+    *v2 = Dataspace::elts(f->sp->array);
+    if (f->sp->array->size != size || arr_type(*v2, size) != type) {
+	return -2;
+    }
+    i_add_ticks(f, size);
+    return type;
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_sum", kf_array_sum, pt_array_sum, 0)
+# else
+char pt_array_sum[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_MIXED,
+			T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * return the sum of an array of ints or floats
+ */
+int kf_array_sum(Frame *f, int n, KFun *kf)
+{
+    unsigned short i;
+    Value *v;
+    Int sum;
+    Float fsum, flt;
+
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    i = f->sp->array->size;
+    v = Dataspace::elts(f->sp->array);
+    switch (arr_type(v, i)) {
+    case T_INT:
+	i_add_ticks(f, i);
+	for (sum = 0; i > 0; --i, v++) {
+	    sum += v->number;
+	}
+	f->sp->array->del();
+	PUT_INTVAL(f->sp, sum);
+	break;
+
+    case T_FLOAT:
+	i_add_ticks(f, i);
+	for (fsum.initZero(); i > 0; --i, v++) {
+	    GET_FLT(v, flt);
+	    fsum.add(flt);
+	}
+	f->sp->array->del();
+	PUT_FLTVAL(f->sp, fsum);
+	break;
+
+    default:
+	return 1;
+    }
+    return 0;
+}
+# endif
+
+
+# ifndef FUNCDEF
+/*
+ * return the smallest or largest value in an array of ints or floats
+ */
+static int arr_extreme(Frame *f, bool max)
+{
+    unsigned short i;
+    Value *v, *w, val;
+    Uuint key, wkey;
+
+    i = f->sp->array->size;
+    v = Dataspace::elts(f->sp->array);
+    if (i == 0) {
+	return 1;
+    }
+    switch (arr_type(v, i)) {
+    case T_INT:
+	i_add_ticks(f, i);
+	for (w = v++; --i > 0; v++) {
+	    if ((v->number > w->number) == max && v->number != w->number) {
+		w = v;
+	    }
+	}
+	break;
+
+    case T_FLOAT:
+	i_add_ticks(f, i);
+	for (w = v++, wkey = arr_fltkey(w); --i > 0; v++) {
+	    key = arr_fltkey(v);
+	    if ((key > wkey) == max && key != wkey) {
+		w = v;
+		wkey = key;
+	    }
+	}
+	break;
+
+    default:
+	return 1;
+    }
+
+    val = *w;
+    f->sp->array->del();
+    *f->sp = val;
+    return 0;
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_min", kf_array_min, pt_array_min, 0)
+# else
+char pt_array_min[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_MIXED,
+			T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * return the smallest value in an array of ints or floats
+ */
+int kf_array_min(Frame *f, int n, KFun *kf)
+{
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    return arr_extreme(f, FALSE);
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_max", kf_array_max, pt_array_max, 0)
+# else
+char pt_array_max[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_MIXED,
+			T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * return the largest value in an array of ints or floats
+ */
+int kf_array_max(Frame *f, int n, KFun *kf)
+{
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    return arr_extreme(f, TRUE);
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_dot", kf_array_dot, pt_array_dot, 0)
+# else
+char pt_array_dot[] = { C_TYPECHECKED | C_STATIC, 2, 0, 0, 8, T_MIXED,
+			T_MIXED | (1 << REFSHIFT), T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * return the dot product of two arrays of ints or floats
+ */
+int kf_array_dot(Frame *f, int n, KFun *kf)
+{
+    unsigned short i;
+    Value *v1, *v2;
+    Int sum;
+    Float fsum, flt1, flt2;
+
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    i = f->sp->array->size;
+    switch (arr_pair(f, &v1, &v2)) {
+    case T_INT:
+	for (sum = 0; i > 0; --i, v1++, v2++) {
+	    sum += v1->number * v2->number;
+	}
+	(f->sp++)->array->del();
+	f->sp->array->del();
+	PUT_INTVAL(f->sp, sum);
+	break;
+
+    case T_FLOAT:
+	for (fsum.initZero(); i > 0; --i, v1++, v2++) {
+	    GET_FLT(v1, flt1);
+	    GET_FLT(v2, flt2);
+	    flt1.mult(flt2);
+	    fsum.add(flt1);
+	}
+	(f->sp++)->array->del();
+	f->sp->array->del();
+	PUT_FLTVAL(f->sp, fsum);
+	break;
+
+    case -1:
+	return 1;
+
+    default:
+	return 2;
+    }
+    return 0;
+}
+# endif
+
+
+# ifndef FUNCDEF
+/*
+ * add or multiply two arrays of ints or floats element by element
+ */
+static int arr_elementwise(Frame *f, bool mult)
+{
+    unsigned short i;
+    Value *v, *v1, *v2;
+    Float flt1, flt2;
+    int type;
+
+    i = f->sp->array->size;
+    type = arr_pair(f, &v1, &v2);
+    if (type < 0) {
+	return -type;
+    }
+
+    /* keep the result on the stack, in case of a float range error */
+    PUSH_ARRVAL(f, Array::create(f->data, i));
+    v = f->sp->array->elts;
+    if (type == T_INT) {
+	if (mult) {
+	    for (; i > 0; --i, v++, v1++, v2++) {
+		PUT_INTVAL(v, v1->number * v2->number);
+	    }
+	} else {
+	    for (; i > 0; --i, v++, v1++, v2++) {
+		PUT_INTVAL(v, v1->number + v2->number);
+	    }
+	}
+    } else {
+	for (; i > 0; --i, v++, v1++, v2++) {
+	    GET_FLT(v1, flt1);
+	    GET_FLT(v2, flt2);
+	    if (mult) {
+		flt1.mult(flt2);
+	    } else {
+		flt1.add(flt2);
+	    }
+	    PUT_FLTVAL(v, flt1);
+	}
+    }
+
+    f->sp[1].array->del();
+    f->sp[2].array->del();
+    f->sp[2] = f->sp[0];
+    f->sp += 2;
+    return 0;
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_add", kf_array_add, pt_array_add, 0)
+# else
+char pt_array_add[] = { C_TYPECHECKED | C_STATIC, 2, 0, 0, 8,
+			T_MIXED | (1 << REFSHIFT), T_MIXED | (1 << REFSHIFT),
+			T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * add two arrays of ints or floats element by element
+ */
+int kf_array_add(Frame *f, int n, KFun *kf)
+{
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    return arr_elementwise(f, FALSE);
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_mult", kf_array_mult, pt_array_mult, 0)
+# else
+char pt_array_mult[] = { C_TYPECHECKED | C_STATIC, 2, 0, 0, 8,
+			 T_MIXED | (1 << REFSHIFT), T_MIXED | (1 << REFSHIFT),
+			 T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * multiply two arrays of ints or floats element by element
+ */
+int kf_array_mult(Frame *f, int n, KFun *kf)
+{
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    return arr_elementwise(f, TRUE);
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_sort", kf_array_sort, pt_array_sort, 0)
+# else
+char pt_array_sort[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7,
+			 T_MIXED | (1 << REFSHIFT), T_MIXED | (1 << REFSHIFT) };
+
+/*
+ * compare two sort keys
+ */
+static int arr_cmp(cvoid *cv1, cvoid *cv2)
+{
+    Uuint k1, k2;
+
+    k1 = *(Uuint *) cv1;
+    k2 = *(Uuint *) cv2;
+    return (k1 < k2) ? -1 : (k1 > k2);
+}
+
+/*
+ * return a sorted copy of an array of ints or floats
+ */
+int kf_array_sort(Frame *f, int n, KFun *kf)
+{
+    unsigned short i, size;
+    Value *v;
+    Uuint *keys, *k;
+    Float flt;
+    Int ticks;
+    int type;
+
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    size = f->sp->array->size;
+    v = Dataspace::elts(f->sp->array);
+    type = arr_type(v, size);
+    if (type == T_NIL) {
+	return 1;
+    }
+    for (ticks = size, i = size; i > 1; i >>= 1) {
+	ticks += size;
+    }
+    i_add_ticks(f, ticks);
+    if (size == 0) {
+	return 0;
+    }
+
+    /* sort unsigned keys that have the same order as the values */
+    keys = ALLOC(Uuint, size);
+    if (type == T_INT) {
+	for (k = keys, i = size; i > 0; --i, v++) {
+	    *k++ = (Uuint) v->number ^ ((Uuint) 1 << 63);
+	}
+    } else {
+	for (k = keys, i = size; i > 0; --i, v++) {
+	    *k++ = arr_fltkey(v);
+	}
+    }
+    std::qsort(keys, size, sizeof(Uuint), arr_cmp);
+
+    PUSH_ARRVAL(f, Array::create(f->data, size));
+    v = f->sp->array->elts;
+    if (type == T_INT) {
+	for (k = keys, i = size; i > 0; --i, v++) {
+	    PUT_INTVAL(v, (Int) (*k++ ^ ((Uuint) 1 << 63)));
+	}
+    } else {
+	for (k = keys, i = size; i > 0; --i, v++) {
+	    arr_keyflt(*k++, &flt);
+	    PUT_FLTVAL(v, flt);
+	}
+    }
+    FREE(keys);
+
+    f->sp[1].array->del();
+    f->sp[1] = f->sp[0];
+    f->sp++;
+    return 0;
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("array_index", kf_array_index, pt_array_index, 0)
+# else
+char pt_array_index[] = { C_TYPECHECKED | C_STATIC, 2, 1, 0, 9, T_INT,
+			  T_MIXED | (1 << REFSHIFT), T_MIXED, T_INT };
+
+/*
+ * return the index of an int or float in an array, or -1
+ */
+int kf_array_index(Frame *f, int nargs, KFun *kf)
+{
+    Int start, first, index;
+    unsigned short size;
+    Value *v, *val;
+
+    UNREFERENCED_PARAMETER(kf);
+
+    if (nargs == 3) {
+	start = (f->sp++)->number;
+    } else {
+	start = 0;
+    }
+    val = f->sp;
+    if (val->type != T_INT && val->type != T_FLOAT) {
+	return 2;
+    }
+    size = f->sp[1].array->size;
+    if (start < 0 || start > size) {
+	return 3;
+    }
+
+    v = Dataspace::elts(f->sp[1].array) + start;
+    first = start;
+    index = -1;
+    if (val->type == T_INT) {
+	for (; start < size; start++, v++) {
+	    if (v->type == T_INT && v->number == val->number) {
+		index = start;
+		break;
+	    }
+	}
+    } else {
+	for (; start < size; start++, v++) {
+	    if (v->type == T_FLOAT && v->oindex == val->oindex &&
+		v->objcnt == val->objcnt) {
+		index = start;
+		break;
+	    }
+	}
+    }
+    i_add_ticks(f, start - first + 1);
+
+    (++f->sp)->array->del();
+    PUT_INTVAL(f->sp, index);
+    return 0;
+}
+# endif
@@ -331,6 +331,31 @@ int kf_call_trace(Frame *f, int n, KFun *kf)
 # endif
 
 
+# ifdef FUNCDEF
+FUNCDEF("profile", kf_profile, pt_profile, 0)
+# else
+char pt_profile[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7,
+		      T_STRING | (1 << REFSHIFT), T_INT };
+
+/*
+ * sample the call chain every so many microseconds, or stop sampling if
+ * the interval is 0; return and remove the stacks sampled so far
+ */
+int kf_profile(Frame *f, int n, KFun *kf)
+{
+    UNREFERENCED_PARAMETER(n);
+    UNREFERENCED_PARAMETER(kf);
+
+    if (f->sp->number < 0) {
+	return 1;
+    }
+    P_profile((Uint) f->sp->number);
+    PUT_ARRVAL(f->sp, f->profile());
+    return 0;
+}
+# endif
+
+
 # ifdef FUNCDEF
 FUNCDEF("clone_object", kf_clone_object, pt_clone_object, 0)
 # else
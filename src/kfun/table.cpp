@@ -60,6 +60,7 @@ extern void kf_dec_key(Frame *, int, Value *);
 extern void kf_xcrypt(Frame *, int, Value *);
 extern void kf_md5(Frame *, int, Value *);
 extern void kf_sha1(Frame *, int, Value *);
+extern void kf_sha256(Frame *, int, Value *);
 
 /*
  * handle an argument error in a builtin kfun
@@ -161,12 +162,13 @@ void KFun::clear()
 	{ "decrypt DES key", proto, kf_dec_key },
 	{ "hash MD5", proto, kf_md5 },
 	{ "hash SHA1", proto, kf_sha1 },
+	{ "hash SHA256", proto, kf_sha256 },
 	{ "hash crypt", proto, kf_xcrypt }
     };
 
     nkfun = sizeof(kforig) / sizeof(KFun);
     ne = nd = nh = 0;
-    add(builtin, 7);
+    add(builtin, 8);
 }
 
 /*
@@ -541,7 +543,7 @@ void KFun::restore(int fd)
 
     /* fix kfuns */
     buffer = ALLOCA(char, dh.kfnamelen);
-    if (P_read(fd, buffer, (unsigned int) dh.kfnamelen) < 0) {
+    if (!Config::read(fd, buffer, (unsigned int) dh.kfnamelen)) {
 	fatal("cannot restore kfun names");
     }
     memset(kfx + KF_BUILTINS, '\0', (nkfun - KF_BUILTINS) * sizeof(kfindex));
@@ -1337,7 +1337,7 @@ void Object::restore(int fd, bool part)
 		}
 		len = (dh.onamelen > CHUNKSZ - buflen) ?
 		       CHUNKSZ - buflen : dh.onamelen;
-		if (P_read(fd, buffer + buflen, len) != len) {
+		if (!Config::read(fd, buffer + buflen, len)) {
 		    fatal("cannot restore object names");
 		}
 		dh.onamelen -= len;
@@ -1460,7 +1460,10 @@ void Object::restore(int fd, bool part)
 }
 
 /*
- * copy objects from dump to swap
+ * copy objects from dump to swap.  A full snapshot takes over the swap
+ * file, and the next one will replace it, so all objects must be copied
+ * within the dump interval.  Incremental snapshots share unmodified sectors
+ * with the swap file, and need no copying
  */
 bool Object::copy(Uint time)
 {
@@ -195,6 +195,31 @@ String *String::add(String *str)
     return s;
 }
 
+/*
+ * find the first occurrence of a separator in a text, using the host's
+ * memchr() to skip ahead to candidate positions
+ */
+char *String::find(char *text, long len, const char *sep, long slen)
+{
+    char *p, *end;
+
+    if (slen == 1) {
+	return (char *) memchr(text, sep[0], len);
+    }
+    end = text + len - slen + 1;
+    for (p = text; p < end; p++) {
+	p = (char *) memchr(p, sep[0], end - p);
+	if (p == (char *) NULL) {
+	    break;
+	}
+	if (memcmp(p + 1, sep + 1, slen - 1) == 0) {
+	    return p;
+	}
+    }
+
+    return (char *) NULL;
+}
+
 /*
  * index a string
  */
@@ -34,6 +34,7 @@ public:
     static void clean();
     static void merge();
     static void clear();
+    static char *find(char *text, long len, const char *sep, long slen);
 
     struct StrRef *primary;	/* primary reference */
     Uint refCount;		/* number of references */
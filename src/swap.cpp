@@ -40,13 +40,23 @@ static Sector nsectors;			/* total swap sectors */
 static Sector nfree;			/* # free sectors */
 static Sector ssectors;			/* sectors actually in swap file */
 static Sector sbarrier;			/* swap sector barrier */
+static Sector *rmap;			/* recycled sector map */
+static Uint *rfresh;			/* recycled sectors written since snapshot */
+static Sector rsize;			/* size of recycled sector map */
+static Sector rfree, rpend;		/* recycled and pending sector lists */
+static Sector tfirst, tlast;		/* tables & header of last snapshot */
+static Sector tnext;			/* tables of snapshot being made */
+static bool recycle;			/* recycle sectors below barrier? */
 static bool swapping;			/* currently using a swapfile? */
+static int cmptype;			/* compression for new swap data */
+static bool dryrun;			/* don't write the snapshot */
+static size_t drysize;			/* size not written in dry run */
 
 /*
  * initialize the swap device
  */
 void Swap::init(char *file, unsigned int total, unsigned int cache,
-		unsigned int secsize)
+		unsigned int secsize, int type)
 {
     SwapSlot *h;
     Sector i;
@@ -60,14 +70,20 @@ void Swap::init(char *file, unsigned int total, unsigned int cache,
     mem = ALLOC(char, slotsize * cache);
     map = ALLOC(Sector, total);
     smap = ALLOC(Sector, total);
+    rmap = ALLOC(Sector, total);
+    rfresh = ALLOC(Uint, BMAP(total));
     cbuf = ALLOC(char, secsize);
     cached = SW_UNUSED;
+    cmptype = type;
 
     /* 0 sectors allocated */
     nsectors = 0;
     ssectors = 0;
     sbarrier = 0;
     nfree = 0;
+    rsize = total;
+    rfree = rpend = SW_UNUSED;
+    recycle = FALSE;
 
     /* init free sector maps */
     mfree = SW_UNUSED;
@@ -110,6 +126,10 @@ void Swap::finish()
  */
 bool Swap::write(int fd, void *buffer, size_t size)
 {
+    if (dryrun) {
+	drysize += size;
+	return TRUE;
+    }
     while (size > SWAPCHUNK) {
 	if (P_write(fd, (char *) buffer, SWAPCHUNK) != SWAPCHUNK) {
 	    return FALSE;
@@ -199,18 +219,72 @@ void Swap::wipev(Sector *vec, unsigned int size)
 	} else {
 	    map[sec] = SW_UNUSED;
 	}
-	if (i != SW_UNUSED && i >= sbarrier) {
-	    /*
-	     * free sector in swap file
-	     */
-	    i -= sbarrier;
-	    smap[i] = sfree;
-	    sfree = i;
+	if (i != SW_UNUSED) {
+	    release(i);
 	}
 	--size;
     }
 }
 
+/*
+ * return TRUE if a sector in the swap file is part of the last snapshot
+ */
+bool Swap::frozen(Sector sec)
+{
+    return (sec < sbarrier && !(recycle && BTST(rfresh, sec)));
+}
+
+/*
+ * allocate a sector in the swap file
+ */
+Sector Swap::salloc()
+{
+    Sector sec;
+
+    if (rfree != SW_UNUSED) {
+	/* reuse a sector no longer referenced by the last snapshot */
+	sec = rfree;
+	rfree = rmap[sec];
+	BSET(rfresh, sec);
+    } else if (sfree != SW_UNUSED) {
+	sec = sfree;
+	sfree = smap[sec];
+	sec += sbarrier;
+    } else {
+	if (ssectors == SW_UNUSED) {
+	    fatal("out of sectors");
+	}
+	sec = ssectors++;
+    }
+    return sec;
+}
+
+/*
+ * release a sector in the swap file
+ */
+void Swap::release(Sector sec)
+{
+    if (sec >= sbarrier) {
+	/*
+	 * free sector in swap file
+	 */
+	sec -= sbarrier;
+	smap[sec] = sfree;
+	sfree = sec;
+    } else if (recycle) {
+	if (BTST(rfresh, sec)) {
+	    /* not part of the last snapshot: reuse immediately */
+	    BCLR(rfresh, sec);
+	    rmap[sec] = rfree;
+	    rfree = sec;
+	} else {
+	    /* reuse when the next snapshot has been made */
+	    rmap[sec] = rpend;
+	    rpend = sec;
+	}
+    }
+}
+
 /*
  * delete a vector of swap sectors
  */
@@ -333,20 +407,14 @@ Swap::SwapSlot *Swap::load(Sector sec, bool restore, bool fill)
 		 * Dump the sector to swap file
 		 */
 
-		if (save == SW_UNUSED || save < sbarrier) {
+		if (save == SW_UNUSED || frozen(save)) {
 		    /*
 		     * allocate new sector in swap file
 		     */
-		    if (sfree == SW_UNUSED) {
-			if (ssectors == SW_UNUSED) {
-			    fatal("out of sectors");
-			}
-			save = ssectors++;
-		    } else {
-			save = sfree;
-			sfree = smap[save];
-			save += sbarrier;
+		    if (save != SW_UNUSED) {
+			release(save);
 		    }
+		    save = salloc();
 		}
 
 		if (swap < 0) {
@@ -549,9 +617,35 @@ Uint Swap::convert(char *m, Sector *vec, const char *layout, Uint n, Uint idx,
 }
 
 /*
- * compress data
+ * return the compression type used for new swap data
+ */
+int Swap::compression()
+{
+    return cmptype;
+}
+
+/*
+ * compress data, return the compressed size or 0 if the size could not
+ * be reduced
  */
 Uint Swap::compress(char *data, char *text, Uint size)
+{
+    switch (cmptype) {
+    case CMP_PRED:
+	return compressPred(data, text, size);
+
+    case CMP_LZ:
+	return compressLZ(data, text, size);
+
+    default:
+	return 0;
+    }
+}
+
+/*
+ * compress data with the predictor
+ */
+Uint Swap::compressPred(char *data, char *text, Uint size)
 {
     char htab[16384];
     unsigned short buf, bufsize, x;
@@ -617,18 +711,218 @@ Uint Swap::compress(char *data, char *text, Uint size)
     return (intptr_t) q - (intptr_t) data;
 }
 
+# define LZHASHBITS	12			/* LZ hash table size */
+# define LZMINMATCH	4			/* minimum match length */
+# define LZMAXOFFSET	0xffff			/* maximum match offset */
+# define LZHASH(x)	(((x) * 2654435761U) >> (32 - LZHASHBITS))
+
+/*
+ * compress data with LZ77, using an LZ4-style block format: each sequence
+ * is a token byte with the literal length in the upper and the match length
+ * in the lower nibble, extended lengths, literals, and a 2 byte match offset
+ */
+Uint Swap::compressLZ(char *data, char *text, Uint size)
+{
+    Uint htab[1 << LZHASHBITS];
+    char *p, *q, *end, *limit, *qend, *lit, *match, *m;
+    Uint len, x, h;
+    int token;
+
+    if (size <= 4 + 1) {
+	/* can't get smaller than this */
+	return 0;
+    }
+
+    /* clear the hash table */
+    memset(htab, '\0', sizeof(htab));
+
+    q = data;
+    *q++ = size >> 24;
+    *q++ = size >> 16;
+    *q++ = size >> 8;
+    *q++ = size;
+    qend = data + size;
+
+    lit = p = text;
+    end = text + size;
+    limit = end - LZMINMATCH;
+    while (p <= limit) {
+	memcpy(&x, p, sizeof(Uint));
+	h = LZHASH(x);
+	match = text + htab[h];
+	htab[h] = p - text;
+	if (match >= p || p - match > LZMAXOFFSET ||
+	    memcmp(match, p, LZMINMATCH) != 0) {
+	    /* no match; skip faster through incompressible data */
+	    p += 1 + ((p - lit) >> 6);
+	    continue;
+	}
+
+	/* extend the match */
+	m = p + LZMINMATCH;
+	match += LZMINMATCH;
+	while (m < end && *m == *match) {
+	    m++;
+	    match++;
+	}
+
+	/* emit sequence */
+	len = p - lit;
+	x = m - p - LZMINMATCH;
+	if (q + 1 + len + len / 255 + 1 + 2 + x / 255 + 1 >= qend) {
+	    return 0;	/* out of space */
+	}
+	token = ((len < 15) ? len : 15) << 4;
+	token |= (x < 15) ? x : 15;
+	*q++ = token;
+	if (len >= 15) {
+	    for (len -= 15; len >= 255; len -= 255) {
+		*q++ = (char) 255;
+	    }
+	    *q++ = len;
+	}
+	len = p - lit;
+	memcpy(q, lit, len);
+	q += len;
+	len = m - match;
+	*q++ = len;
+	*q++ = len >> 8;
+	if (x >= 15) {
+	    for (x -= 15; x >= 255; x -= 255) {
+		*q++ = (char) 255;
+	    }
+	    *q++ = x;
+	}
+
+	lit = p = m;
+    }
+
+    /* final literals */
+    len = end - lit;
+    if (q + 1 + len / 255 + 1 + len >= qend) {
+	return 0;	/* compression did not reduce size */
+    }
+    *q++ = ((len < 15) ? len : 15) << 4;
+    if (len >= 15) {
+	for (x = len - 15; x >= 255; x -= 255) {
+	    *q++ = (char) 255;
+	}
+	*q++ = x;
+    }
+    memcpy(q, lit, len);
+    q += len;
+
+    return (intptr_t) q - (intptr_t) data;
+}
+
+/*
+ * read the extension of an LZ77 length
+ */
+static Uint lzLength(char **data, char *end, Uint len, Uint max)
+{
+    char *p;
+    int c;
+
+    p = *data;
+    do {
+	if (p >= end || len > max) {
+	    fatal("corrupted LZ compressed data");
+	}
+	c = UCHAR(*p++);
+	len += c;
+    } while (c == 255);
+    *data = p;
+    return len;
+}
+
+/*
+ * decompress LZ77 data, checking every length and offset before copying
+ */
+void Swap::decompressLZ(char *data, char *text, Uint size, Uint dsize)
+{
+    char *p, *end, *q, *m;
+    Uint len, offset;
+    int token;
+
+    p = data;
+    end = data + size;
+    q = text;
+    while (p < end) {
+	/* literals */
+	token = UCHAR(*p++);
+	len = token >> 4;
+	if (len == 15) {
+	    len = lzLength(&p, end, len, dsize);
+	}
+	if (len > (Uint) (end - p) || len > dsize - (Uint) (q - text)) {
+	    fatal("corrupted LZ compressed data");
+	}
+	memcpy(q, p, len);
+	q += len;
+	p += len;
+	if (p >= end) {
+	    break;
+	}
+
+	/* match */
+	if (end - p < 2) {
+	    fatal("corrupted LZ compressed data");
+	}
+	offset = UCHAR(p[0]) | (UCHAR(p[1]) << 8);
+	p += 2;
+	len = token & 0xf;
+	if (len == 15) {
+	    len = lzLength(&p, end, len, dsize);
+	}
+	len += LZMINMATCH;
+	if (offset == 0 || offset > (Uint) (q - text) ||
+	    len > dsize - (Uint) (q - text)) {
+	    fatal("corrupted LZ compressed data");
+	}
+	m = q - offset;
+	if (offset >= len) {
+	    memcpy(q, m, len);
+	    q += len;
+	} else {
+	    /* overlapping copy */
+	    do {
+		*q++ = *m++;
+	    } while (--len != 0);
+	}
+    }
+
+    if (q != text + dsize) {
+	fatal("corrupted LZ compressed data");
+    }
+}
+
 /*
  * read and decompress data from the swap file
  */
 char *Swap::decompress(Sector *sectors,
 		       void (*readv) (char*, Sector*, Uint, Uint),
-		       Uint size, Uint offset, Uint *dsize)
+		       Uint size, Uint offset, Uint *dsize, int type)
 {
     char buffer[8192], htab[16384];
     unsigned short buf, bufsize, x;
     Uint n;
     char *p, *q;
 
+    if (type == CMP_LZ) {
+	/* read everything at once */
+	if (size < 4) {
+	    fatal("corrupted LZ compressed data");
+	}
+	p = ALLOC(char, size);
+	(*readv)(p, sectors, size, offset);
+	*dsize = (UCHAR(p[0]) << 24) | (UCHAR(p[1]) << 16) |
+		 (UCHAR(p[2]) << 8) | UCHAR(p[3]);
+	q = ALLOC(char, *dsize);
+	decompressLZ(p + 4, q, size - 4, *dsize);
+	FREE(p);
+	return q;
+    }
+
     buf = bufsize = 0;
     x = 0;
 
@@ -729,21 +1023,14 @@ int Swap::save(char *snapshot, bool keep)
 	    /*
 	     * Dump the sector to swap file
 	     */
-	    if (sec == SW_UNUSED || sec < sbarrier) {
+	    if (sec == SW_UNUSED || frozen(sec)) {
 		/*
 		 * allocate new sector in swap file
 		 */
-		if (sfree == SW_UNUSED) {
-		    if (ssectors == SW_UNUSED) {
-			fatal("out of sectors");
-		    }
-		    sec = ssectors++;
-		} else {
-		    sec = sfree;
-		    sfree = smap[sec];
-		    sec += sbarrier;
+		if (sec != SW_UNUSED) {
+		    release(sec);
 		}
-		h->swap = sec;
+		h->swap = sec = salloc();
 	    }
 	    P_lseek(swap, (off_t) (sec + 1L) * sectorsize, SEEK_SET);
 	    if (!write(swap, h + 1, sectorsize)) {
@@ -808,10 +1095,90 @@ int Swap::save(char *snapshot, bool keep)
 	}
     }
 
+    return swap;
+}
+
+/*
+ * reopen the snapshot, for writing it from a background process
+ */
+int Swap::reopen(char *snapshot)
+{
+    char buf[STRINGSZ];
+
+    swap = P_open(path_native(buf, snapshot), O_RDWR | O_BINARY, 0);
+    if (swap < 0) {
+	Config::dumpError("cannot reopen snapshot");
+    }
+    return swap;
+}
+
+/*
+ * update the state as if the snapshot was written, without actually
+ * writing it.  Return the size of what was not written
+ */
+size_t Swap::dryRun(bool flag)
+{
+    size_t size;
+
+    size = drysize;
+    dryrun = flag;
+    drysize = 0;
+    return size;
+}
+
+/*
+ * find a range of recycled sectors to hold the tables of a snapshot
+ */
+Sector Swap::place(Sector n)
+{
+    Sector sec, first, *s;
+    Uint *bitmap;
+
+    bitmap = ALLOC(Uint, BMAP(sbarrier));
+    memset(bitmap, '\0', BMAP(sbarrier) * sizeof(Uint));
+    for (sec = rfree; sec != SW_UNUSED; sec = rmap[sec]) {
+	BSET(bitmap, sec);
+    }
+    for (first = sec = 0; sec < sbarrier && sec - first < n; sec++) {
+	if (!BTST(bitmap, sec)) {
+	    first = sec + 1;
+	}
+    }
+    FREE(bitmap);
+    if (sec - first < n) {
+	return ssectors;	/* append */
+    }
+
+    /* remove range from recycled sectors */
+    for (s = &rfree; *s != SW_UNUSED; ) {
+	if (*s >= first && *s < sec) {
+	    *s = rmap[*s];
+	} else {
+	    s = &rmap[*s];
+	}
+    }
+    return first;
+}
+
+/*
+ * write the sector map to the snapshot, followed by tables of the given
+ * size, if known
+ */
+void Swap::saveMap(size_t size)
+{
+    SwapSlot *h;
+
+    tnext = ssectors;
+    if (recycle && size != 0) {
+	/* map, tables and header */
+	tnext = place((nsectors * sizeof(Sector) + size + sectorsize - 1) /
+								sectorsize + 1);
+    }
+
     /* write map */
-    P_lseek(swap, (off_t) (ssectors + 1L) * sectorsize, SEEK_SET);
+    P_lseek(swap, (off_t) (tnext + 1L) * sectorsize, SEEK_SET);
     if (!write(swap, map, nsectors * sizeof(Sector))) {
-	fatal("cannot write sector map to snapshot");
+	Config::dumpError("cannot write sector map to snapshot");
     }
 
     /* fix the sector map */
@@ -819,8 +1186,67 @@ int Swap::save(char *snapshot, bool keep)
 	map[h->sec] = ((intptr_t) h - (intptr_t) mem) / slotsize;
 	h->dirty = FALSE;
     }
+}
 
-    return swap;
+/*
+ * After an incremental snapshot, the sectors of the previous snapshot that
+ * are not shared with the new one can be reused.  This includes sectors
+ * that were replaced or freed since, and the tables of the previous
+ * snapshot.
+ */
+void Swap::recycled(Sector tend, Sector barrier)
+{
+    Sector sec, next;
+
+    if (dump >= 0) {
+	/* partial snapshot: map may still refer to the secondary snapshot */
+	recycle = FALSE;
+	return;
+    }
+
+    if (barrier > rsize) {
+	Sector size;
+
+	/* the snapshot outgrew the swap: double the size */
+	size = rsize;
+	do {
+	    size = (size <= SW_UNUSED / 2) ? size * 2 : SW_UNUSED;
+	} while (size < barrier);
+	Alloc::staticMode();
+	rmap = REALLOC(rmap, Sector, rsize, size);
+	rfresh = REALLOC(rfresh, Uint, BMAP(rsize), BMAP(size));
+	Alloc::dynamicMode();
+	rsize = size;
+    }
+    memset(rfresh, '\0', BMAP(barrier) * sizeof(Uint));
+
+    if (recycle) {
+	/* sectors replaced since the previous snapshot */
+	for (sec = rpend; sec != SW_UNUSED; sec = next) {
+	    next = rmap[sec];
+	    rmap[sec] = rfree;
+	    rfree = sec;
+	}
+
+	/* tables and header of the previous snapshot */
+	for (sec = tfirst; sec < tlast; sec++) {
+	    rmap[sec] = rfree;
+	    rfree = sec;
+	}
+    } else {
+	rfree = SW_UNUSED;
+    }
+    rpend = SW_UNUSED;
+
+    /* free sectors above the previous barrier */
+    for (sec = sfree; sec != SW_UNUSED; sec = smap[sec]) {
+	rmap[sec + sbarrier] = rfree;
+	rfree = sec + sbarrier;
+    }
+
+    tfirst = tnext;
+    tlast = tend;
+    recycle = TRUE;
 }
 
 /*
@@ -828,7 +1254,6 @@ int Swap::save(char *snapshot, bool keep)
  */
 void Swap::save2(SnapshotInfo *header, int size, bool incr)
 {
-    static off_t prev;
     off_t sectors;
     Uint offset;
     DumpHeader dh;
@@ -843,7 +1268,7 @@ void Swap::save2(SnapshotInfo *header, int size, bool incr)
 	sectors /= sectorsize;
 	if (offset != 0) {
 	    if (!write(swap, cbuf, sectorsize - offset)) {
-		fatal("cannot extend swap file");
+		Config::dumpError("cannot extend swap file");
 	    }
 	    sectors++;
 	}
@@ -851,32 +1276,33 @@ void Swap::save2(SnapshotInfo *header, int size, bool incr)
 
     if (swapping) {
 	P_lseek(swap, 0, SEEK_SET);
-	prev = 0;
     }
 
     /* write header */
     memcpy(cbuf, header, size);
     dh.secsize = sectorsize;
     dh.nsectors = nsectors;
-    dh.ssectors = ssectors;
+    dh.ssectors = tnext;
     dh.nfree = nfree;
     dh.mfree = mfree;
     memcpy(cbuf + sectorsize - sizeof(DumpHeader), &dh, sizeof(DumpHeader));
     if (!write(swap, cbuf, sectorsize)) {
-	fatal("cannot write snapshot header");
+	Config::dumpError("cannot write snapshot header");
     }
 
     if (!swapping) {
-	/* let the previous header refer to the current one */
+	/*
+	 * let the first header refer to the current one, so that the
+	 * headers in between need not be kept
+	 */
 	save[0] = sectors >> 24;
 	save[1] = sectors >> 16;
 	save[2] = sectors >> 8;
 	save[3] = sectors;
-	P_lseek(swap, prev * sectorsize + size - sizeof(save), SEEK_SET);
+	P_lseek(swap, size - sizeof(save), SEEK_SET);
 	if (!write(swap, save, sizeof(save))) {
-	    fatal("cannot write offset");
+	    Config::dumpError("cannot write offset");
 	}
-	prev = sectors;
     }
 
     if (incr) {
@@ -887,6 +1313,13 @@ void Swap::save2(SnapshotInfo *header, int size, bool incr)
 	if (sectors > SW_UNUSED) {
 	    sectors = SW_UNUSED;
 	}
+	if (sectors < ssectors) {
+	    /* tables were placed in recycled sectors */
+	    recycled(sectors, ssectors);
+	    sectors = ssectors;
+	} else {
+	    recycled(sectors, sectors);
+	}
 	sbarrier = ssectors = sectors;
 	swapping = FALSE;
     } else {
@@ -896,6 +1329,7 @@ void Swap::save2(SnapshotInfo *header, int size, bool incr)
 	sbarrier = ssectors = 0;
 	swapping = TRUE;
 	restoresecsize = sectorsize;
+	recycle = FALSE;
     }
     sfree = SW_UNUSED;
     cached = SW_UNUSED;
@@ -907,10 +1341,12 @@ void Swap::save2(SnapshotInfo *header, int size, bool incr)
 void Swap::restore(int fd, unsigned int secsize)
 {
     DumpHeader dh;
+    off_t start, end;
 
     /* restore swap header */
     P_lseek(fd, -(off_t) (Config::dsize(dh_layout) & 0xff), SEEK_CUR);
     Config::dread(fd, (char *) &dh, dh_layout, (Uint) 1);
+    end = P_lseek(fd, 0, SEEK_CUR) - secsize;
     if (dh.secsize != secsize) {
 	error("Wrong sector size (%d)", dh.secsize);
     }
@@ -922,8 +1358,19 @@ void Swap::restore(int fd, unsigned int secsize)
 	cbuf = REALLOC(cbuf, char, 0, secsize);
     }
 
-    /* seek beyond swap sectors */
-    P_lseek(fd, (off_t) (dh.ssectors + 1L) * secsize, SEEK_SET);
+    /*
+     * seek beyond swap sectors, and read all tables up to the header, or up
+     * to the end of the file if the header is at the start
+     */
+    start = (off_t) (dh.ssectors + 1L) * secsize;
+    if (end < start) {
+	end = P_lseek(fd, 0, SEEK_END);
+    }
+    if (end < start || end - start > (Uint) -1) {
+	error("Bad snapshot table size");
+    }
+    P_lseek(fd, start, SEEK_SET);
+    Config::preload(fd, (Uint) (end - start));
 
     /* restore swap map */
     Config::dread(fd, (char *) map, "d", (Uint) dh.nsectors);
@@ -17,6 +17,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* data compression */
+# define CMP_TYPE		0x03
+# define CMP_NONE		0x00	/* no compression */
+# define CMP_PRED		0x01	/* predictor compression */
+# define CMP_LZ			0x02	/* LZ77 compression */
+
 class Swap {
 public:
     struct SwapSlot {		/* swap slot header */
@@ -28,11 +34,12 @@ public:
     };
 
     static void init(char *file, unsigned int total, unsigned int cache,
-		     unsigned int secsize);
+		     unsigned int secsize, int type);
     static void finish();
     static bool write(int fd, void *buffer, size_t size);
     static void wipev(Sector *vec, unsigned int size);
     static void delv(Sector *vec, unsigned int size);
+    static Sector mapsize(unsigned int size);
     static Sector alloc(Uint size, Sector nsectors, Sector **sectors);
     static void readv(char*, Sector*, Uint, Uint);
     static void writev(char*, Sector*, Uint, Uint);
@@ -41,20 +48,31 @@ public:
     static void conv2(char*, Sector*, Uint, Uint);
     static Uint convert(char *m, Sector *vec, const char *layout, Uint n,
 			Uint idx, void (*readv) (char*, Sector*, Uint, Uint));
+    static int compression();
     static Uint compress(char *data, char *text, Uint size);
     static char *decompress(Sector *sectors,
 			    void (*readv) (char*, Sector*, Uint, Uint),
-			    Uint size, Uint offset, Uint *dsize);
+			    Uint size, Uint offset, Uint *dsize, int type);
     static Sector count();
     static bool copy(Uint);
     static int save(char*, bool);
+    static int reopen(char *snapshot);
+    static size_t dryRun(bool flag);
+    static void saveMap(size_t size);
     static void save2(SnapshotInfo*, int, bool);
     static void restore(int, unsigned int);
     static void restore2(int);
 
 private:
     static void create();
-    static Sector mapsize(unsigned int);
     static void newv(Sector *vec, unsigned int size);
+    static bool frozen(Sector sec);
+    static Sector salloc();
+    static void release(Sector sec);
+    static Sector place(Sector n);
+    static void recycled(Sector tend, Sector barrier);
     static SwapSlot *load(Sector sec, bool restore, bool fill);
+    static Uint compressPred(char *data, char *text, Uint size);
+    static Uint compressLZ(char *data, char *text, Uint size);
+    static void decompressLZ(char *data, char *text, Uint size, Uint dsize);
 };
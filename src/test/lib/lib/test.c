@@ -0,0 +1,127 @@
+/*
+ * inherited by the objects in /test
+ */
+
+private object driver;		/* driver object */
+private int failures;		/* # failed checks */
+private mixed *start;		/* start time of benchmark */
+
+static void tests()		{ }
+static void benchmarks()	{ }
+
+/*
+ * run the tests, return the number of failed checks
+ */
+int test()
+{
+    driver = previous_object();
+    failures = 0;
+    tests();
+    return failures;
+}
+
+/*
+ * run the benchmarks
+ */
+int bench()
+{
+    driver = previous_object();
+    benchmarks();
+    return 0;
+}
+
+/*
+ * print a message
+ */
+static void message(string str)
+{
+    driver->message(str);
+}
+
+/*
+ * return TRUE if the tests run with non-default options, such as binary
+ * save files
+ */
+static int options()
+{
+    return driver->options();
+}
+
+/*
+ * check a test result
+ */
+static void check(int ok, string name)
+{
+    if (!ok) {
+	message("FAILED: " + object_name(this_object()) + ": " + name + "\n");
+	failures++;
+    }
+}
+
+/*
+ * check a result against the expected value
+ */
+static void expect(mixed result, mixed value, string name)
+{
+    if (result != value) {
+	message("FAILED: " + object_name(this_object()) + ": " + name +
+		": got " + result + ", expected " + value + "\n");
+	failures++;
+    }
+}
+
+/*
+ * start timing a benchmark
+ */
+static void begin()
+{
+    start = millitime();
+}
+
+/*
+ * report the time taken by a benchmark
+ */
+static void end(string name)
+{
+    mixed *t;
+
+    t = millitime();
+    message(object_name(this_object()) + ": " + name + ": " +
+	    ((t[0] - start[0]) * 1000 + (int) ((t[1] - start[1]) * 1000.0)) +
+	    " ms\n");
+}
+
+/*
+ * continue the tests with a function called after a delay in seconds
+ */
+static void delay(int seconds, string func, mixed args...)
+{
+    driver->wait();
+    call_out("step", seconds, func, args);
+}
+
+/*
+ * continue the tests with a function called in a later task, for instance
+ * after everything has been swapped out
+ */
+static void later(string func, mixed args...)
+{
+    delay(0, func, args...);
+}
+
+/*
+ * call the function that continues the tests
+ */
+static void step(string func, mixed *args)
+{
+    string err;
+
+    failures = 0;
+    err = catch(call_other(this_object(), func, args...));
+    if (err) {
+	message("FAILED: " + object_name(this_object()) + ": " + func + ": " +
+		err + "\n");
+	failures++;
+    }
+    driver->done(failures);
+}
@@ -0,0 +1,3 @@
+/*
+ * auto object
+ */
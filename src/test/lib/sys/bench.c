@@ -0,0 +1,10 @@
+/*
+ * driver object for the benchmarks
+ */
+# include "driver.h"
+
+static void initialize()
+{
+    run("bench");
+    shutdown();
+}
@@ -0,0 +1,87 @@
+/*
+ * driver object functions shared by /sys/test and /sys/bench
+ */
+
+string path_read(string path)		{ return path; }
+string path_write(string path)		{ return path; }
+string path_object(string path)		{ return path; }
+string include_file(string from, string path) { return path; }
+string object_type(string from, string type) { return type; }
+int compile_rlimits(string objname)	{ return 1; }
+int runtime_rlimits(object obj, int depth, int ticks) { return 1; }
+int touch(object obj, string func)	{ return 0; }
+void recompile(object obj)		{ }
+object telnet_connect(int port)		{ return nil; }
+object binary_connect(int port)		{ return nil; }
+static void interrupt()			{ shutdown(); }
+
+/*
+ * find or compile an object
+ */
+private object load(string path)
+{
+    object obj;
+
+    obj = find_object(path);
+    return (obj) ? obj : compile_object(path);
+}
+
+object inherit_program(string from, string path, int priv)
+{
+    return load(path);
+}
+
+object call_object(string path)
+{
+    return load(path);
+}
+
+/*
+ * print a message
+ */
+void message(string str)
+{
+    send_message(str);
+}
+
+void compile_error(string file, int line, string err)
+{
+    send_message(file + ", " + line + ": " + err + "\n");
+}
+
+void runtime_error(string err, int caught, int ticks)
+{
+    mixed **trace;
+    int i;
+
+    if (!caught) {
+	send_message(err + "\n");
+	trace = call_trace();
+	for (i = sizeof(trace) - 2; i >= 0; --i) {
+	    send_message("    " + trace[i][2] + " in " + trace[i][1] + ":" +
+			 trace[i][3] + "\n");
+	}
+    }
+}
+
+void atomic_error(string err, int atom, int ticks)
+{
+    send_message(err + " (atomic)\n");
+}
+
+/*
+ * call a function in each object in /test, and return the sum of the
+ * results
+ */
+static int run(string func)
+{
+    string *files;
+    int i, result;
+
+    files = get_dir("/test/*.c")[0];
+    for (i = 0; i < sizeof(files); i++) {
+	result += call_other(load("/test/" + files[i][.. strlen(files[i]) - 3]),
+			     func);
+    }
+    return result;
+}
@@ -0,0 +1,5 @@
+/*
+ * driver object for the tests with non-default options
+ */
+# define OPTIONS	1	/* non-default options */
+# include "test.c"
@@ -0,0 +1,61 @@
+/*
+ * driver object for the tests
+ */
+# include "driver.h"
+
+# ifndef OPTIONS
+# define OPTIONS	0	/* default options, see /sys/options */
+# endif
+
+private int failures;		/* # failed checks */
+private int waiting;		/* # tests continued later */
+
+/*
+ * finish when no tests are left to continue
+ */
+private void finish()
+{
+    if (waiting == 0) {
+	if (failures != 0) {
+	    send_message(failures + " tests failed\n");
+	} else {
+	    send_message("All tests passed\n");
+	}
+	shutdown();
+    }
+}
+
+static void initialize()
+{
+    failures = run("test");
+    if (failures != 0 && waiting == 0) {
+	error(failures + " tests failed");
+    }
+    finish();
+}
+
+/*
+ * return TRUE if the tests run with non-default options
+ */
+int options()
+{
+    return OPTIONS;
+}
+
+/*
+ * a test will be continued in a later task
+ */
+void wait()
+{
+    waiting++;
+}
+
+/*
+ * a test was continued
+ */
+void done(int n)
+{
+    failures += n;
+    --waiting;
+    finish();
+}
@@ -0,0 +1,128 @@
+/*
+ * int and float operators, which the interpreter runs inline when the
+ * compiler knows the operand types
+ */
+inherit "/lib/test";
+
+/*
+ * int operators on typed operands
+ */
+private int *typed_int(int a, int b)
+{
+    return ({ a + b, a - b, a * b, a & b, a | b, a ^ b, ~a, -a, !a, a + 1,
+	      a - 1, a == b, a != b, a < b, a <= b, a > b, a >= b,
+	      (a < b) ? 1 : 2, (a >= b) ? 1 : 2, (a == b) ? 1 : 2 });
+}
+
+/*
+ * int operators on untyped operands
+ */
+private int *mixed_int(mixed a, mixed b)
+{
+    return ({ a + b, a - b, a * b, a & b, a | b, a ^ b, ~a, -a, !a, a + 1,
+	      a - 1, a == b, a != b, a < b, a <= b, a > b, a >= b,
+	      (a < b) ? 1 : 2, (a >= b) ? 1 : 2, (a == b) ? 1 : 2 });
+}
+
+/*
+ * float operators on typed operands
+ */
+private mixed *typed_float(float a, float b)
+{
+    return ({ a + b, a - b, a * b, (b != 0.0) ? a / b : 0.0, a == b, a != b,
+	      a < b, a <= b, a > b, a >= b, (a < b) ? 1 : 2, (a > b) ? 1 : 2 });
+}
+
+/*
+ * float operators on untyped operands
+ */
+private mixed *mixed_float(mixed a, mixed b)
+{
+    return ({ a + b, a - b, a * b, (b != 0.0) ? a / b : 0.0, a == b, a != b,
+	      a < b, a <= b, a > b, a >= b, (a < b) ? 1 : 2, (a > b) ? 1 : 2 });
+}
+
+/*
+ * compare two arrays element by element
+ */
+private void compare(mixed *typed, mixed *untyped, string name)
+{
+    int i;
+
+    for (i = 0; i < sizeof(typed); i++) {
+	expect(typed[i], untyped[i], name + " #" + i);
+    }
+}
+
+static void tests()
+{
+    int *ints, i, j, n;
+    float *floats, f;
+    string err;
+
+    ints = ({ 0, 1, -1, 2, 7, -13, 255, 65536, 2147483647, -2147483647 - 1 });
+    for (i = 0; i < sizeof(ints); i++) {
+	for (j = 0; j < sizeof(ints); j++) {
+	    compare(typed_int(ints[i], ints[j]), mixed_int(ints[i], ints[j]),
+		    ints[i] + " op " + ints[j]);
+	}
+    }
+    floats = ({ 0.0, 1.0, -1.0, 0.5, 3.25, -1e10, 1e-30, 1e100 });
+    for (i = 0; i < sizeof(floats); i++) {
+	for (j = 0; j < sizeof(floats); j++) {
+	    compare(typed_float(floats[i], floats[j]),
+		    mixed_float(floats[i], floats[j]),
+		    floats[i] + " op " + floats[j]);
+	}
+    }
+
+    /* known answers */
+    compare(typed_int(7, -13),
+	    ({ -6, 20, -91, 3, -9, -12, -8, -7, 0, 8, 6, 0, 1, 0, 0, 1, 1, 2, 1,
+	       2 }),
+	    "7 op -13");
+    compare(typed_float(1.5, -0.25),
+	    ({ 1.25, 1.75, -0.375, -6.0, 0, 1, 0, 0, 1, 1, 2, 1 }),
+	    "1.5 op -0.25");
+
+    /* loops on typed conditions */
+    for (i = n = 0; i < 100; i++) {
+	if (i % 3 == 0 && i != 99) {
+	    n += i;
+	}
+    }
+    expect(n, 1584, "int loop");
+    for (f = 0.0, n = 0; f < 10.0; f += 0.5) {
+	n++;
+    }
+    expect(n, 20, "float loop");
+
+    err = catch(f = 1.0 / (f - f));
+    expect(err, "Division by zero", "float division by zero");
+    f = 1.7e308;
+    err = catch(f = f * 10.0);
+    expect(err, "Result too large", "float overflow");
+}
+
+static void benchmarks()
+{
+    int i, a, b;
+    float f, g;
+
+    begin();
+    for (i = a = 0, b = 1; i < 3000000; i++) {
+	a += (b ^ i) & 0xff;
+	if (a > 100000) {
+	    a -= 100000;
+	}
+    }
+    end("3000000 int loop iterations");
+    begin();
+    for (i = 0, f = 0.0, g = 1.0; i < 1000000; i++) {
+	f = f * 0.5 + g;
+	if (f > 1.5) {
+	    g = -g;
+	}
+    }
+    end("1000000 float loop iterations");
+}
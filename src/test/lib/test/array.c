@@ -0,0 +1,174 @@
+/*
+ * array_sum(), array_min(), array_max(), array_dot(), array_add(),
+ * array_mult(), array_sort() and array_index()
+ */
+inherit "/lib/test";
+
+/*
+ * pseudo-random ints, both negative and positive
+ */
+private int *ints(int n)
+{
+    int *a, i, seed;
+
+    a = allocate_int(n);
+    for (i = 0, seed = 4711; i < n; i++) {
+	seed = seed * 1103515245 + 12345;
+	a[i] = seed;
+    }
+    return a;
+}
+
+/*
+ * pseudo-random floats, both negative and positive, of different
+ * magnitudes
+ */
+private float *floats(int n)
+{
+    float *a;
+    int *b, i;
+
+    a = allocate_float(n);
+    b = ints(n);
+    for (i = 0; i < n; i++) {
+	a[i] = ldexp((float) b[i], (b[i] & 0x3f) - 32);
+    }
+    return a;
+}
+
+/*
+ * sort with insertion sort
+ */
+private mixed *slowsort(mixed *a)
+{
+    mixed x;
+    int i, j;
+
+    a = a[..];
+    for (i = 1; i < sizeof(a); i++) {
+	x = a[i];
+	for (j = i; j > 0 && a[j - 1] > x; --j) {
+	    a[j] = a[j - 1];
+	}
+	a[j] = x;
+    }
+    return a;
+}
+
+/*
+ * compare two arrays element by element
+ */
+private void same(mixed *result, mixed *value, string name)
+{
+    int i;
+
+    expect(sizeof(result), sizeof(value), name + " size");
+    for (i = 0; i < sizeof(value); i++) {
+	expect(result[i], value[i], name + " " + i);
+    }
+}
+
+static void tests()
+{
+    mixed *a, *b, *empty, *mixedup, *strings;
+    int *i1;
+    float *f1;
+    string err;
+
+    empty = ({ });
+    mixedup = ({ 1, 2.0 });
+    strings = ({ "1", "2" });
+
+    /* array_sum() */
+    expect(array_sum(({ 1, -2, 3 })), 2, "sum of ints");
+    expect(array_sum(({ 0.5, -2.25, 3.0 })), 1.25, "sum of floats");
+    expect(array_sum(empty), 0, "empty sum");
+    err = catch(array_sum(mixedup));
+    expect(err, "Bad argument 1 for kfun array_sum", "sum of ints and floats");
+    err = catch(array_sum(strings));
+    expect(err, "Bad argument 1 for kfun array_sum", "sum of strings");
+    err = catch(array_sum(({ 1e308, 1e308 })));
+    expect(err, "Result too large", "sum too large");
+
+    /* array_min() and array_max() */
+    a = ({ 3, -7, 0, 0x7fffffff, -0x80000000, 5 });
+    expect(array_min(a), -0x80000000, "min of ints");
+    expect(array_max(a), 0x7fffffff, "max of ints");
+    b = ({ 0.5, -1e100, 1e-100, -1e-100, 1e100, 0.0 });
+    expect(array_min(b), -1e100, "min of floats");
+    expect(array_max(b), 1e100, "max of floats");
+    expect(array_min(({ -0.5, -0.25 })), -0.5, "min of negative floats");
+    expect(array_max(({ -0.5, -0.25 })), -0.25, "max of negative floats");
+    err = catch(array_min(empty));
+    expect(err, "Bad argument 1 for kfun array_min", "empty min");
+    err = catch(array_max(empty));
+    expect(err, "Bad argument 1 for kfun array_max", "empty max");
+    err = catch(array_min(mixedup));
+    expect(err, "Bad argument 1 for kfun array_min", "min of ints and floats");
+    err = catch(array_max(strings));
+    expect(err, "Bad argument 1 for kfun array_max", "max of strings");
+
+    /* array_dot() */
+    expect(array_dot(({ 1, 2, 3 }), ({ 4, -5, 6 })), 12, "dot of ints");
+    expect(array_dot(({ 0.5, 2.0 }), ({ 4.0, -0.25 })), 1.5, "dot of floats");
+    expect(array_dot(empty, empty), 0, "empty dot");
+    err = catch(array_dot(({ 1, 2 }), ({ 1, 2, 3 })));
+    expect(err, "Bad argument 2 for kfun array_dot", "dot size mismatch");
+    err = catch(array_dot(({ 1, 2 }), ({ 1.0, 2.0 })));
+    expect(err, "Bad argument 2 for kfun array_dot", "dot type mismatch");
+    err = catch(array_dot(mixedup, mixedup));
+    expect(err, "Bad argument 1 for kfun array_dot", "dot of ints and floats");
+    err = catch(array_dot(strings, strings));
+    expect(err, "Bad argument 1 for kfun array_dot", "dot of strings");
+
+    /* array_add() and array_mult() */
+    same(array_add(({ 1, -2 }), ({ 3, 4 })), ({ 4, 2 }), "add ints");
+    same(array_add(({ 0.5 }), ({ -1.0 })), ({ -0.5 }), "add floats");
+    same(array_mult(({ 1, -2 }), ({ 3, 4 })), ({ 3, -8 }), "multiply ints");
+    same(array_mult(({ 0.5 }), ({ -1.0 })), ({ -0.5 }), "multiply floats");
+    a = ({ 1, 2 });
+    b = array_add(a, ({ 0, 0 }));
+    check(a != b, "add returns a new array");
+    same(array_add(empty, empty), empty, "add empty arrays");
+    err = catch(array_add(({ 1 }), ({ 1, 2 })));
+    expect(err, "Bad argument 2 for kfun array_add", "add size mismatch");
+    err = catch(array_mult(({ 1 }), ({ 1.0 })));
+    expect(err, "Bad argument 2 for kfun array_mult", "multiply type mismatch");
+    err = catch(array_add(mixedup, mixedup));
+    expect(err, "Bad argument 1 for kfun array_add", "add ints and floats");
+    err = catch(array_mult(strings, strings));
+    expect(err, "Bad argument 1 for kfun array_mult", "multiply strings");
+    err = catch(array_mult(({ 1e200 }), ({ 1e200 })));
+    expect(err, "Result too large", "product too large");
+
+    /* array_sort() */
+    i1 = ints(1000) + ({ 0x7fffffff, -0x80000000, 0, -1 });
+    a = i1[..];
+    same(array_sort(i1), slowsort(i1), "sort ints");
+    same(i1, a, "original array unchanged");
+    f1 = floats(1000) + ({ 0.0, -0.0, 1e300, -1e300, 1e-300, -1e-300 });
+    same(array_sort(f1), slowsort(f1), "sort floats");
+    same(array_sort(({ -0.5, -2.0, -1.0 })), ({ -2.0, -1.0, -0.5 }),
+	 "sort negative floats");
+    same(array_sort(empty), empty, "sort empty array");
+    err = catch(array_sort(mixedup));
+    expect(err, "Bad argument 1 for kfun array_sort", "sort ints and floats");
+    err = catch(array_sort(strings));
+    expect(err, "Bad argument 1 for kfun array_sort", "sort strings");
+
+    /* array_index() */
+    a = ({ "1", 1.0, 1, nil, 2, 1 });
+    expect(array_index(a, 1), 2, "index of int");
+    expect(array_index(a, 1.0), 1, "index of float");
+    expect(array_index(a, 1, 3), 5, "index of int after start");
+    expect(array_index(a, 1.0, 2), -1, "float not found");
+    expect(array_index(a, 3), -1, "int not found");
+    expect(array_index(a, 2, 6), -1, "start at end");
+    expect(array_index(empty, 0), -1, "index in empty array");
+    err = catch(array_index(a, 1, 7));
+    expect(err, "Bad argument 3 for kfun array_index", "start after end");
+    err = catch(array_index(a, 1, -1));
+    expect(err, "Bad argument 3 for kfun array_index", "negative start");
+    err = catch(array_index(a, "1"));
+    expect(err, "Bad argument 2 for kfun array_index", "index of string");
+}
@@ -0,0 +1,171 @@
+/*
+ * arbitrary precision multiplication, which multiplies numbers of less
+ * than KARATSUBA words directly
+ */
+inherit "/lib/test";
+
+/*
+ * a positive number of len pseudo-random bytes
+ */
+private string number(int len, int seed)
+{
+    string str;
+    int i;
+
+    str = "\0";
+    for (i = 1; i <= len; i++) {
+	seed = seed * 1103515245 + 12345;
+	str += " ";
+	str[i] = seed >> 16;
+    }
+    return str;
+}
+
+/*
+ * 2 ** (8 * len), larger than any product of numbers of len bytes
+ * together
+ */
+private string limit(int len)
+{
+    string str;
+    int i;
+
+    str = "\1";
+    for (i = 0; i < len; i++) {
+	str += "\0";
+    }
+    return str;
+}
+
+/*
+ * multiply by shifting and adding
+ */
+private string slow_mult(string a, string b, string mod)
+{
+    string result;
+    int i, bit;
+
+    result = "\0";
+    for (i = 0; i < strlen(b); i++) {
+	for (bit = 0x80; bit != 0; bit >>= 1) {
+	    result = asn_add(result, result, mod);
+	    if (b[i] & bit) {
+		result = asn_add(result, a, mod);
+	    }
+	}
+    }
+    return result;
+}
+
+/*
+ * multiply by a number 8 bytes at a time
+ */
+private string chunked_mult(string a, string b, string mod)
+{
+    string result;
+    int i, shift;
+
+    result = "\0";
+    for (i = strlen(b), shift = 0; i > 0; i -= 8, shift += 64) {
+	result = asn_add(result,
+			 asn_lshift(asn_mult(a, "\0" + b[(i > 8) ? i - 8 : 0 ..
+							     i - 1],
+					     mod),
+				    shift, mod),
+			 mod);
+    }
+    return result;
+}
+
+/*
+ * raise to a power by repeated multiplication
+ */
+private string slow_pow(string a, int e, string mod)
+{
+    string result;
+
+    for (result = "\1"; e > 0; --e) {
+	result = asn_mult(result, a, mod);
+    }
+    return asn_mod(result, mod);
+}
+
+static void tests()
+{
+    int *lens, i, j, e;
+    string a, b, m, exp;
+
+    /* known answers */
+    expect(asn_mult("\3", "\5", "\1\0"), "\17", "3 * 5");
+    expect(asn_mult("\xfd", "\5", "\1\0\0"), "\xf1", "-3 * 5");
+    expect(asn_mult("\0\xff\xff\xff\xff\xff\xff\xff\xff",
+		    "\0\xff\xff\xff\xff\xff\xff\xff\xff", limit(17)),
+	   "\0\xff\xff\xff\xff\xff\xff\xff\xfe\0\0\0\0\0\0\0\1",
+	   "(2 ** 64 - 1) ** 2");
+    expect(asn_pow("\2", "\1\0", limit(40)), limit(32), "2 ** 256");
+    expect(asn_sub("\1\0\0\0\0\0\0\0\0", "\1\0\0\0\0\0\0\0\1", limit(40)),
+	   "\xff", "2 ** 64 - (2 ** 64 + 1)");
+    expect(asn_sub("\1\0\0\0\0", "\2\0\0\0\0", limit(40)), "\xff\0\0\0\0",
+	   "2 ** 32 - 2 ** 33");
+    expect(asn_pow("\3", "\5", "\1\2\3\4\6"), "\0\xf3",
+	   "3 ** 5, even modulus");
+
+    /* products against shift and add, and against 8 byte products */
+    lens = ({ 1, 2, 3, 4, 5, 8, 9, 16, 17, 63, 64, 65, 124, 127, 128, 129,
+	      132, 200, 256, 257, 300 });
+    for (i = 0; i < sizeof(lens); i++) {
+	for (j = 0; j < sizeof(lens); j++) {
+	    a = number(lens[i], i);
+	    b = number(lens[j], j + 100);
+	    m = limit(lens[i] + lens[j] + 1);
+	    expect(asn_mult(a, b, m),
+		   (lens[j] <= 17) ? slow_mult(a, b, m) :
+				     chunked_mult(a, b, m),
+		   "product of " + lens[i] + " and " + lens[j] + " bytes");
+	}
+    }
+
+    /* squares and powers, with odd and even moduli */
+    for (i = 0; i < sizeof(lens); i++) {
+	a = number(lens[i], i + 200);
+	m = number(lens[i], i + 300);
+	m[strlen(m) - 1] |= 1;
+	for (j = 0; j < 2; j++) {
+	    expect(asn_pow(a, "\2", m), asn_mod(asn_mult(a, a, m), m),
+		   "square of " + lens[i] + " bytes, " +
+		   ((j) ? "even" : "odd") + " modulus");
+	    for (e = 3; e < 20; e += 5) {
+		exp = " ";
+		exp[0] = e;
+		expect(asn_pow(a, exp, m), slow_pow(a, e, m),
+		       lens[i] + " bytes to the power " + e + ", " +
+		       ((j) ? "even" : "odd") + " modulus");
+	    }
+	    m[strlen(m) - 1] &= ~1;
+	}
+    }
+}
+
+static void benchmarks()
+{
+    string a, b, m;
+    int i;
+
+    a = number(512, 1);
+    b = number(512, 2);
+    m = limit(1025);
+    begin();
+    for (i = 0; i < 2000; i++) {
+	asn_mult(a, b, m);
+    }
+    end("2000 products of 4096 bit numbers");
+    a = number(256, 3);
+    b = number(256, 4);
+    m = number(256, 5);
+    m[256] |= 1;
+    begin();
+    for (i = 0; i < 20; i++) {
+	asn_pow(a, b, m);
+    }
+    end("20 2048 bit modular powers");
+}
@@ -0,0 +1,111 @@
+/*
+ * hash_crc16() and hash_crc32(), which process 8 bytes at a time
+ */
+inherit "/lib/test";
+
+/*
+ * CRC-16/CCITT of a string, one bit at a time
+ */
+private int slow_crc16(string str)
+{
+    int crc, i, j;
+
+    crc = 0xffff;
+    for (i = 0; i < strlen(str); i++) {
+	crc ^= str[i] << 8;
+	for (j = 0; j < 8; j++) {
+	    crc = ((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1) & 0xffff;
+	}
+    }
+    return crc;
+}
+
+/*
+ * CRC-32 of a string, one bit at a time
+ */
+private int slow_crc32(string str)
+{
+    int crc, i, j;
+
+    crc = 0xffffffff;
+    for (i = 0; i < strlen(str); i++) {
+	crc ^= str[i];
+	for (j = 0; j < 8; j++) {
+	    crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+    }
+    return ~crc;
+}
+
+/*
+ * a string of pseudo-random bytes
+ */
+private string bytes(int len)
+{
+    string str;
+    int i, seed;
+
+    str = "";
+    for (i = 0, seed = 12345; i < len; i++) {
+	seed = seed * 1103515245 + 12345;
+	str += " ";
+	str[i] = seed >> 16;
+    }
+    return str;
+}
+
+static void tests()
+{
+    string str, s;
+    int i, len;
+
+    /* check values */
+    expect(hash_crc16("123456789"), 0x29b1, "CRC-16 check");
+    expect(hash_crc32("123456789"), 0xcbf43926, "CRC-32 check");
+    expect(hash_crc16(""), 0xffff, "CRC-16 of nothing");
+    expect(hash_crc32(""), 0, "CRC-32 of nothing");
+    expect(hash_crc32("The quick brown fox jumps over the lazy dog"),
+	   0x414fa339, "CRC-32 of text");
+
+    /* all lengths up to 40, at every alignment */
+    str = bytes(48);
+    for (i = 0; i < 8; i++) {
+	for (len = 0; len <= 40; len++) {
+	    s = str[i .. i + len - 1];
+	    expect(hash_crc16(s), slow_crc16(s), "CRC-16 " + i + "/" + len);
+	    expect(hash_crc32(s), slow_crc32(s), "CRC-32 " + i + "/" + len);
+	}
+    }
+
+    /* split over several arguments */
+    str = bytes(1000);
+    for (i = 0; i <= 1000; i += 7) {
+	expect(hash_crc16(str[.. i - 1], str[i ..]), hash_crc16(str),
+	       "CRC-16 split at " + i);
+	expect(hash_crc32(str[.. i - 1], "", str[i ..]), hash_crc32(str),
+	       "CRC-32 split at " + i);
+    }
+    expect(hash_crc32(str), slow_crc32(str), "CRC-32 of 1000 bytes");
+}
+
+static void benchmarks()
+{
+    string str;
+    int i;
+
+    str = bytes(1000);
+    while (strlen(str) < 30000) {
+	str += str;
+    }
+    str = str[.. 29999];
+    begin();
+    for (i = 0; i < 2000; i++) {
+	hash_crc16(str);
+    }
+    end("2000 CRC-16s of 30000 bytes");
+    begin();
+    for (i = 0; i < 2000; i++) {
+	hash_crc32(str);
+    }
+    end("2000 CRC-32s of 30000 bytes");
+}
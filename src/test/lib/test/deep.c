@@ -0,0 +1,120 @@
+/*
+ * deep recursion, which uses frames from the frame pool rather than the
+ * native stack
+ */
+inherit "/lib/test";
+
+private int value;		/* changed by atomic functions */
+
+/*
+ * recurse without tail calls
+ */
+private int deep(int n)
+{
+    return (n == 0) ? 0 : deep(n - 1) + 1;
+}
+
+/*
+ * recurse within resource limits
+ */
+private void limited(int depth, int ticks, int n)
+{
+    rlimits (depth; ticks) {
+	deep(n);
+    }
+}
+
+/*
+ * recurse, then fail
+ */
+private int fail(int n)
+{
+    if (n == 0) {
+	error("Deep error");
+    }
+    return fail(n - 1) + 1;
+}
+
+/*
+ * recurse, then catch an error from deeper down
+ */
+private string catcher(int n, int m)
+{
+    string err;
+
+    if (n == 0) {
+	err = catch(fail(m));
+	return err + " " + deep(1000);
+    }
+    return catcher(n - 1, m) + "";
+}
+
+/*
+ * recurse, then run out of ticks
+ */
+private string ticks(int n)
+{
+    if (n == 0) {
+	return catch(limited(-1, 10000, 100000));
+    }
+    return ticks(n - 1) + "";
+}
+
+/*
+ * recurse, then fail in an atomic function
+ */
+private atomic int change(int n)
+{
+    value += 1;
+    if (n == 0) {
+	error("Atomic error");
+    }
+    return change(n - 1) + 1;
+}
+
+/*
+ * recurse, then call an atomic function
+ */
+private string atomically(int n, int m)
+{
+    string err;
+
+    if (n == 0) {
+	err = catch(change(m));
+	return err + " " + value;
+    }
+    return atomically(n - 1, m) + "";
+}
+
+static void tests()
+{
+    string err;
+
+    /* deeper than the native stack allows */
+    expect(deep(200000), 200000, "recursion 200000 deep");
+    expect(deep(10), 10, "recursion after deep recursion");
+
+    /* errors */
+    err = catch(fail(150000));
+    expect(err, "Deep error", "error from 150000 deep");
+    expect(deep(150000), 150000, "recursion after deep error");
+    expect(catcher(100000, 50000), "Deep error 1000",
+	   "error caught 100000 deep");
+    err = catch(deep(0x7fffffff));
+    expect(err, "Stack overflow", "frame pool exhausted");
+    expect(deep(100000), 100000, "recursion after stack overflow");
+
+    /* rlimits */
+    err = catch(limited(1000, -1, 2000));
+    expect(err, "Stack overflow", "maximum depth");
+    expect(ticks(100000), "Out of ticks", "ticks exhausted 100000 deep");
+
+    /* atomic functions */
+    value = 0;
+    expect(atomically(100000, 50000), "Atomic error 0",
+	   "atomic error 100000 deep");
+    value = 0;
+    err = catch(change(150000));
+    expect(err, "Atomic error", "atomic error from 150000 deep");
+    expect(value, 0, "atomic changes undone");
+}
@@ -0,0 +1,75 @@
+/*
+ * get_dir() and its directory listing cache
+ */
+inherit "/lib/test";
+
+# define DIR	"/dir.tmp"
+
+/*
+ * names and sizes of a listing
+ */
+private string list(mixed **dir)
+{
+    string str;
+    int i;
+
+    str = "";
+    for (i = 0; i < sizeof(dir[0]); i++) {
+	str += " " + dir[0][i] + ":" + dir[1][i];
+    }
+    return str;
+}
+
+static void tests()
+{
+    make_dir(DIR);
+    expect(list(get_dir(DIR + "/*")), "", "empty");
+    write_file(DIR + "/b.c", "bb");
+    write_file(DIR + "/a.c", "a");
+    make_dir(DIR + "/sub");
+    expect(list(get_dir(DIR + "/*")), " a.c:1 b.c:2 sub:-2", "created");
+    write_file(DIR + "/a.c", "aaa");
+    expect(list(get_dir(DIR + "/*")), " a.c:4 b.c:2 sub:-2", "appended");
+    expect(list(get_dir(DIR + "/*.c")), " a.c:4 b.c:2", "pattern");
+    expect(list(get_dir(DIR + "/[ab].?")), " a.c:4 b.c:2", "class");
+    expect(list(get_dir(DIR + "/a.c")), " a.c:4", "single");
+    expect(list(get_dir(DIR + "/\\a.c")), " a.c:4", "escaped");
+    expect(list(get_dir(DIR + "/z.c")), "", "missing");
+    rename_file(DIR + "/a.c", DIR + "/c.c");
+    expect(list(get_dir(DIR + "/*")), " b.c:2 c.c:4 sub:-2", "renamed");
+    remove_file(DIR + "/c.c");
+    remove_dir(DIR + "/sub");
+    expect(list(get_dir(DIR + "/*")), " b.c:2", "removed");
+    remove_file(DIR + "/b.c");
+    remove_dir(DIR);
+    expect(list(get_dir(DIR + "/*")), "", "directory removed");
+}
+
+static void benchmarks()
+{
+    int i;
+
+    make_dir(DIR);
+    for (i = 0; i < 3000; i++) {
+	write_file(DIR + "/f" + i + ".c", "x");
+    }
+    begin();
+    for (i = 0; i < 200; i++) {
+	get_dir(DIR + "/*");
+    }
+    end("200 listings of 3000 files");
+    begin();
+    for (i = 0; i < 2000; i++) {
+	get_dir(DIR + "/f17*");
+    }
+    end("2000 listings of 111 of 3000 files");
+    begin();
+    for (i = 0; i < 2000; i++) {
+	get_dir(DIR + "/f1234.c");
+    }
+    end("2000 listings of a single file");
+    for (i = 0; i < 3000; i++) {
+	remove_file(DIR + "/f" + i + ".c");
+    }
+    remove_dir(DIR);
+}
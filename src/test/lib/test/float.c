@@ -0,0 +1,126 @@
+/*
+ * floats, which are computed with doubles and rounded to 36 bits of
+ * mantissa when stored
+ */
+inherit "/lib/test";
+
+/*
+ * 1.0 + k * 2 ** -44 rounded to 36 bits of mantissa, nearest even
+ */
+private float rounded(float base, int k)
+{
+    int q, r;
+
+    q = k >> 8;
+    r = k & 0xff;
+    if (r > 0x80 || (r == 0x80 && (q & 1))) {
+	q++;
+    }
+    return base + ldexp((float) q, -36);
+}
+
+static void tests()
+{
+    float f, ulp, base;
+    mixed *m;
+    int *highs, i, k, e;
+    string err, str;
+
+    /* rounding to 36 bits */
+    ulp = ldexp(1.0, -36);
+    f = 1.0;
+    expect((f + ulp) - f, ulp, "1 + ulp");
+    expect((f + ulp / 2.0) - f, 0.0, "1 + ulp / 2");
+    expect((f + ulp * 0.75) - f, ulp, "1 + 3 * ulp / 4");
+    expect(((f + ulp) + ulp / 2.0) - f, ulp * 2.0, "1 + 3 * ulp / 2");
+    expect((-f - ulp / 2.0) + f, 0.0, "-1 - ulp / 2");
+    expect(((-f - ulp) - ulp / 2.0) + f, ulp * -2.0, "-1 - 3 * ulp / 2");
+    expect(((2.0 - ulp) + ulp / 2.0), 2.0, "2 - ulp / 2");
+
+    /* cross-check against rounding with ints */
+    highs = ({ 0, 1, 0x155, 0x2aaaaaaa, 0x3fffffff });
+    for (i = 0; i < sizeof(highs); i++) {
+	base = 1.0 + ldexp((float) highs[i], -30);
+	for (k = 0; k < 0x400; k++) {
+	    for (e = -1000; e <= 1000; e += 500) {
+		expect(ldexp(base + ldexp((float) k, -44), e),
+		       ldexp(rounded(base, k), e),
+		       "round " + highs[i] + " + " + k + ", scaled by 2 ** " +
+		       e);
+		expect(ldexp(-base - ldexp((float) k, -44), e),
+		       ldexp(-rounded(base, k), e),
+		       "round -" + highs[i] + " - " + k +
+		       ", scaled by 2 ** " + e);
+	    }
+	}
+    }
+
+    /* range */
+    f = ldexp(2.0 - ulp, 1023);
+    m = frexp(f);
+    expect(m[0], 1.0 - ulp / 2.0, "largest mantissa");
+    expect(m[1], 1024, "largest exponent");
+    err = catch(f += ldexp(1.0, 1023 - 37));
+    expect(err, "Result too large", "rounding to overflow");
+    f = ldexp(1.0, -1022);
+    m = frexp(f);
+    expect(m[0], 0.5, "smallest mantissa");
+    expect(m[1], -1021, "smallest exponent");
+    expect(f / 2.0, 0.0, "no denormals");
+    f = 1e-300;
+    expect(f * 1e-10, 0.0, "underflow");
+
+    /* known answers */
+    expect(sqrt(2.0), 1.4142135623730951, "sqrt(2)");
+    expect(sin(1.0), 0.8414709848078965, "sin(1)");
+    expect(exp(1.0), 2.718281828459045, "exp(1)");
+    expect(log(10.0), 2.302585092994046, "log(10)");
+    expect(atan(1.0) * 4.0, 3.141592653589793, "atan(1) * 4");
+    m = frexp(sqrt(2.0));
+    expect(m[0], 0.7071067811865476, "frexp(sqrt(2))[0]");
+    expect(m[1], 1, "frexp(sqrt(2))[1]");
+
+    /* conversions */
+    f = 1.0;
+    expect((string) (f / 10.0), "0.1", "0.1 to string");
+    expect((string) (f / 3.0), "0.333333333", "1 / 3 to string");
+    expect((string) 1e100, "1e+100", "1e100 to string");
+    expect((string) -2.5e-7, "-0.00000025", "-2.5e-7 to string");
+    str = "0.1";
+    expect((float) str, f / 10.0, "0.1 from string");
+    str = "1.7976931348623157e308";
+    err = catch(f = (float) str);
+    expect(err, "String cannot be converted to float", "DBL_MAX from string");
+    i = 2147483647;
+    f = (float) i;
+    expect(f, 2147483647.0, "int to float");
+    expect((int) f, 2147483647, "float to int");
+    f = -2.5;
+    expect((int) f, -3, "-2.5 to int");
+}
+
+static void benchmarks()
+{
+    int i;
+    float f, g;
+    string str;
+
+    begin();
+    for (i = 0, f = 0.0, g = 0.001; i < 300000; i++) {
+	f += sqrt(g) + sin(g) + exp(g);
+	g += 0.001;
+    }
+    end("300000 sqrt, sin and exp");
+    begin();
+    for (i = 0, f = 0.0, g = 1.0; i < 300000; i++) {
+	f = f * g + 0.5;
+	g = 1.0 - g * 0.5;
+    }
+    end("300000 float multiply and add");
+    begin();
+    for (i = 0, f = 1.0 / 3.0; i < 100000; i++) {
+	str = (string) f;
+	g = (float) str;
+    }
+    end("100000 float to string and back");
+}
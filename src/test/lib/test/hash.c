@@ -0,0 +1,127 @@
+/*
+ * hash_update() and hash_final(), which hash incrementally through a
+ * hash context
+ */
+inherit "/lib/test";
+
+/*
+ * a string as hexadecimal digits
+ */
+private string hex(string str)
+{
+    string digits, result;
+    int i;
+
+    digits = "0123456789abcdef";
+    result = "";
+    for (i = 0; i < strlen(str); i++) {
+	result += digits[str[i] >> 4 .. str[i] >> 4] +
+		  digits[str[i] & 0xf .. str[i] & 0xf];
+    }
+    return result;
+}
+
+/*
+ * a string of pseudo-random bytes
+ */
+private string bytes(int len)
+{
+    string str;
+    int i, seed;
+
+    str = "";
+    for (i = 0, seed = 54321; i < len; i++) {
+	seed = seed * 1103515245 + 12345;
+	str += " ";
+	str[i] = seed >> 16;
+    }
+    return str;
+}
+
+/*
+ * hash a string in two parts
+ */
+private mixed split(string alg, string str, int i)
+{
+    return hash_final(hash_update(hash_update(alg, str[.. i - 1]),
+				  str[i ..]));
+}
+
+static void tests()
+{
+    string str, ctx, bad, err, *algs;
+    int i, j, len;
+
+    /* FIPS 180-2 test vectors */
+    expect(hex(hash_final(hash_update("SHA256"))),
+	   "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+	   "SHA-256 of nothing");
+    expect(hex(hash_final(hash_update("SHA256", "abc"))),
+	   "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+	   "SHA-256 of abc");
+    expect(hex(hash_final(hash_update("SHA256",
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))),
+	   "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+	   "SHA-256 of 448 bits");
+    str = "a";
+    while (strlen(str) < 1000) {
+	str += str;
+    }
+    str = str[.. 999];
+    ctx = "SHA256";
+    for (i = 0; i < 1000; i++) {
+	ctx = hash_update(ctx, str);
+    }
+    expect(hex(hash_final(ctx)),
+	   "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+	   "SHA-256 of a million a's");
+
+    /* all lengths across the padding boundaries, split everywhere */
+    algs = ({ "MD5", "SHA1", "SHA256" });
+    str = bytes(130);
+    for (len = 0; len <= 130; len++) {
+	for (j = 0; j < sizeof(algs); j++) {
+	    expect(hash_final(hash_update(algs[j], str[.. len - 1])),
+		   hash_string(algs[j], str[.. len - 1]),
+		   algs[j] + " of " + len + " bytes");
+	}
+	expect(hash_final(hash_update("CRC32", str[.. len - 1])),
+	       hash_crc32(str[.. len - 1]), "CRC32 of " + len + " bytes");
+    }
+    for (len = 55; len <= 65; len++) {
+	for (i = 0; i <= len; i++) {
+	    for (j = 0; j < sizeof(algs); j++) {
+		expect(split(algs[j], str[.. len - 1], i),
+		       hash_string(algs[j], str[.. len - 1]),
+		       algs[j] + " of " + len + " bytes split at " + i);
+	    }
+	    expect(split("CRC32", str[.. len - 1], i),
+		   hash_crc32(str[.. len - 1]),
+		   "CRC32 of " + len + " bytes split at " + i);
+	}
+    }
+    expect(hash_final(hash_update("SHA1", str[.. 9], str[10 .. 99], "",
+				  str[100 ..])),
+	   hash_string("SHA1", str), "SHA1 of several arguments");
+
+    /* bad contexts */
+    err = catch(hash_update("SHA512", "abc"));
+    expect(err, "Unknown hash algorithm", "unknown algorithm");
+    ctx = hash_update("SHA256", str[.. 69]);
+    err = catch(hash_final(ctx[.. strlen(ctx) - 2]));
+    expect(err, "Bad hash context", "truncated context");
+    err = catch(hash_update(ctx[.. 5], "abc"));
+    expect(err, "Bad hash context", "truncated header");
+    bad = ctx;
+    bad[1] = 4;
+    err = catch(hash_final(bad));
+    expect(err, "Bad hash context", "bad algorithm");
+    bad = ctx;
+    bad[9] ^= 1;
+    err = catch(hash_update(bad, "abc"));
+    expect(err, "Bad hash context", "length and buffer size mismatch");
+    bad = ctx;
+    bad[1] = 2;
+    err = catch(hash_final(bad));
+    expect(err, "Bad hash context", "digest size mismatch");
+}
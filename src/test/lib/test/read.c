@@ -0,0 +1,52 @@
+/*
+ * read_file() and its cache of recently read file extents
+ */
+inherit "/lib/test";
+
+# define FILE	"/read.tmp"
+# define OTHER	"/other.tmp"
+# define ALIAS	"/alias"	/* symbolic link to the base directory */
+
+string text;			/* saved by save_object() */
+
+static void tests()
+{
+    remove_file(FILE);
+    remove_file(OTHER);
+    write_file(FILE, "abc");
+    write_file(OTHER, "def");
+    expect(read_file(FILE), "abc", "read");
+    expect(read_file(FILE, 1, 1), "b", "extent");
+
+    /*
+     * changed without read_file() being told, most likely in the same
+     * second that it was read in
+     */
+    write_file(ALIAS + FILE, "xyz", -3);
+    expect(read_file(FILE), "xyz", "rewritten in the same second");
+    expect(read_file(FILE, 1, 1), "y", "extent rewritten in the same second");
+
+    delay(1, "cached");
+}
+
+static void cached()
+{
+    expect(read_file(FILE), "xyz", "read later");
+    expect(read_file(FILE), "xyz", "read again");
+    expect(read_file(OTHER), "def", "other file read later");
+    expect(read_file(OTHER), "def", "other file read again");
+
+    /* rewritten with the same size */
+    write_file(ALIAS + FILE, "abc", -3);
+    expect(read_file(FILE), "abc", "rewritten");
+
+    /* replaced by renaming a new file */
+    text = "saved";
+    save_object(ALIAS + OTHER);
+    check(read_file(OTHER) != "def", "replaced");
+    expect(read_file(OTHER), read_file(ALIAS + OTHER), "replacement read");
+
+    remove_file(FILE);
+    remove_file(OTHER);
+    expect(read_file(FILE), nil, "removed");
+}
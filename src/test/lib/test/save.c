@@ -0,0 +1,230 @@
+/*
+ * save_object() and restore_object(), with text save files, or binary save
+ * files when the tests run with non-default options
+ */
+# include <type.h>
+
+inherit "/lib/test";
+
+# define FILE	"/save.tmp"
+
+/* not private, as private variables are not saved */
+int num;			/* saved int */
+mixed value;			/* saved value */
+mixed other;			/* another saved value, saved last */
+
+/*
+ * called in the clone
+ */
+void set(mixed v, mixed o)
+{
+    value = v;
+    other = o;
+}
+
+mixed *query()
+{
+    return ({ value, other });
+}
+
+void save(string file)
+{
+    save_object(file);
+}
+
+/*
+ * restore, and return either the result or the error
+ */
+mixed restore(string file)
+{
+    string err;
+    int result;
+
+    err = catch(result = restore_object(file));
+    return (err) ? err : result;
+}
+
+/*
+ * compare two values, recursing into arrays and mappings
+ */
+private int equal(mixed a, mixed b)
+{
+    int i;
+
+    if (typeof(a) != typeof(b)) {
+	return 0;
+    }
+    switch (typeof(a)) {
+    case T_MAPPING:
+	return equal(map_indices(a), map_indices(b)) &&
+	       equal(map_values(a), map_values(b));
+
+    case T_ARRAY:
+	if (sizeof(a) != sizeof(b)) {
+	    return 0;
+	}
+	for (i = 0; i < sizeof(a); i++) {
+	    if (!equal(a[i], b[i])) {
+		return 0;
+	    }
+	}
+	return 1;
+
+    default:
+	return (a == b);
+    }
+}
+
+/*
+ * a binary save file made from strings and bytes
+ */
+private string binary(mixed parts...)
+{
+    string str, byte;
+    int i;
+
+    str = " DGDSAVE";
+    str[0] = 0;
+    byte = " ";
+    for (i = 0; i < sizeof(parts); i++) {
+	if (typeof(parts[i]) == T_INT) {
+	    byte[0] = parts[i];
+	    str += byte;
+	} else {
+	    str += parts[i];
+	}
+    }
+    return str;
+}
+
+/*
+ * restore a file in the clone
+ */
+private mixed rewrite(object clone, string str)
+{
+    remove_file(FILE);
+    write_file(FILE, str);
+    return clone->restore(FILE);
+}
+
+/*
+ * restore truncated copies of a binary save file
+ */
+private void truncated(object clone, mixed *shared)
+{
+    string full;
+    mixed result;
+    int i, n;
+
+    full = read_file(FILE);
+    for (i = 8, n = 0; i < strlen(full); i++) {
+	result = rewrite(clone, full[.. i - 1]);
+	if (result == 1) {
+	    /* only whole variables may be restored */
+	    check(!equal(clone->query()[1], shared), "truncated at " + i);
+	} else {
+	    result = explode(result, ": ");
+	    expect(result[sizeof(result) - 1], "unexpected end of file",
+		   "truncated at " + i);
+	    n++;
+	}
+    }
+    /* all but the magic alone, and the magic with the first variable */
+    expect(n, strlen(full) - 10, "truncated files rejected");
+    expect(rewrite(clone, full[.. strlen(full) - 2]),
+	   "Format error in \"" + FILE + "\", line 2: unexpected end of file",
+	   "last byte missing");
+}
+
+/*
+ * restore corrupted binary save files
+ */
+private void corrupted(object clone)
+{
+    expect(rewrite(clone, binary(5, "value", 9)),
+	   "Format error in \"" + FILE + "\", line 1: bad value", "bad value");
+    expect(rewrite(clone, binary(0)),
+	   "Format error in \"" + FILE + "\", line 1: bad variable name",
+	   "empty variable name");
+    expect(rewrite(clone, binary(5, "value", 4, 1, 6, 1)),
+	   "Format error in \"" + FILE + "\", line 1: bad array reference",
+	   "bad array reference");
+    expect(rewrite(clone, binary(5, "value", 4, 1, 7, 0)),
+	   "Format error in \"" + FILE + "\", line 1: bad mapping reference",
+	   "array referenced as mapping");
+    expect(rewrite(clone, binary(5, "value", 1, 0xff, 0xff, 0xff, 0xff, 0xff,
+				 1)),
+	   "Format error in \"" + FILE + "\", line 1: number too large",
+	   "number too large");
+    expect(rewrite(clone, binary(5, "value", 2, 0x7f, 0xf0, 0, 0, 0, 0)),
+	   "Format error in \"" + FILE + "\", line 1: illegal exponent",
+	   "illegal exponent");
+    expect(rewrite(clone, binary(5, "value", 3, 0xff, 0xff, 0xff, 0xff, 0x0f,
+				 "text")),
+	   "Format error in \"" + FILE + "\", line 1: unexpected end of file",
+	   "string longer than the file");
+    expect(rewrite(clone, binary(3, "num", 3, 4, "text")),
+	   "Format error in \"" + FILE + "\", line 1: value has wrong type",
+	   "wrong type");
+    expect(rewrite(clone, binary(3, "num", 1, 0x0d, 5, "value", 1, 0x0f)), 1,
+	   "hand-made file");
+    expect(clone->query()[0], -8, "hand-made value");
+}
+
+static void tests()
+{
+    object clone;
+    mixed *shared, *values, *result;
+    mapping map;
+    string str, full;
+
+    clone = clone_object(this_object());
+
+    /* round trip */
+    str = "\t";
+    str[0] = 0xff;
+    str = "x" + str + "\n";
+    str[0] = 0;
+    full = "0123456789";
+    while (strlen(full) < 10000) {
+	full += full;
+    }
+    shared = ({ 1, 2 });
+    map = ([ 1 : "one", "two" : 2.0, 3.5 : ({ nil }), 4 : this_object() ]);
+    values = ({ 0, 1, -1, 63, -64, 64, -65, 0x7fffffff, -0x80000000,
+		0.0, 1.5, -1e300, 1e-300, "", "text", str, full, nil,
+		this_object(), ({ }), ({ ({ 1, ({ -2, ({ }) }) }) }), ([ ]),
+		map, shared, shared, map });
+    clone->set(values, shared);
+    remove_file(FILE);
+    clone->save(FILE);
+    clone->set(nil, nil);
+    expect(clone->restore(FILE), 1, "restored");
+    result = clone->query();
+    values[18] = nil;
+    map[4] = nil;
+    check(equal(result[0], values), "values restored");
+    check(result[0][23] == result[0][24], "shared array");
+    check(result[0][22] == result[0][25], "shared mapping");
+    check(result[1] == result[0][23], "array shared between variables");
+
+    str = " DGDSAVE";
+    str[0] = 0;
+    if (options()) {
+	expect(read_file(FILE, 0, 8), str, "binary file");
+	truncated(clone, shared);
+	corrupted(clone);
+    } else {
+	check(read_file(FILE, 0, 8) != str, "text file");
+    }
+
+    /* text file, in either case */
+    expect(rewrite(clone, "num 3\nvalue ({2|-1,\"two\",})\n"), 1,
+	   "text file restored");
+    check(equal(clone->query(), ({ ({ -1, "two" }), nil })),
+	  "text file values");
+
+    remove_file(FILE);
+    expect(clone->restore(FILE), 0, "no file");
+    destruct_object(clone);
+}
@@ -0,0 +1,78 @@
+/*
+ * function call statistics in status(obj)[O_FUNCSTATS], which are only
+ * kept when the tests run with non-default options
+ */
+# include <status.h>
+# include <type.h>
+
+inherit "/lib/test";
+
+/*
+ * loop for a while
+ */
+int counted(int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) ;
+    return n;
+}
+
+/*
+ * never called
+ */
+int uncalled()
+{
+    return 0;
+}
+
+/*
+ * fail after a while
+ */
+private void failing()
+{
+    counted(1000);
+    error("Failed");
+}
+
+/*
+ * call with resource limits, so that ticks are counted
+ */
+private void limited(string func, int n)
+{
+    rlimits (-1; 1000000) {
+	call_other(this_object(), func, n);
+    }
+}
+
+static void tests()
+{
+    mapping stats;
+    mixed *counts;
+    int i;
+
+    if (!options()) {
+	expect(status(this_object())[O_FUNCSTATS], nil, "no statistics");
+	return;
+    }
+
+    for (i = 0; i < 10; i++) {
+	limited("counted", 1000);
+    }
+    catch(failing());
+    stats = status(this_object())[O_FUNCSTATS];
+    expect(typeof(stats), T_MAPPING, "mapping");
+
+    counts = stats["counted"];
+    expect(typeof(counts), T_ARRAY, "array");
+    expect(sizeof(counts), 3, "array size");
+    expect(counts[0], 11, "calls");
+    check(typeof(counts[1]) == T_INT && counts[1] >= 10000, "ticks");
+    check(typeof(counts[2]) == T_INT && counts[2] >= 0, "usec");
+    expect(stats["limited"][0], 10, "calls with resource limits");
+    expect(stats["failing"][0], 1, "calls that ended in an error");
+    expect(stats["uncalled"], nil, "function not called");
+    expect(stats["test"], nil, "inherited function");
+    check(status(find_object("/lib/test"))[O_FUNCSTATS]["test"][0] >= 1,
+	  "function in inherited program");
+}
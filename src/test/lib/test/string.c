@@ -0,0 +1,107 @@
+/*
+ * explode(), implode() and sscanf(), which search for separators with
+ * String::find()
+ */
+inherit "/lib/test";
+
+/*
+ * explode a string by comparing the separator at every position
+ */
+private string *slow_explode(string str, string sep)
+{
+    string *parts;
+    int len, slen, start, i;
+
+    parts = ({ });
+    len = strlen(str);
+    slen = strlen(sep);
+    if (len >= slen && str[.. slen - 1] == sep) {
+	start = slen;	/* skip leading separator */
+    }
+    for (i = start; i <= len - slen; ) {
+	if (str[i .. i + slen - 1] == sep) {
+	    parts += ({ str[start .. i - 1] });
+	    i += slen;
+	    start = i;
+	} else {
+	    i++;
+	}
+    }
+    if (start < len || (len != 0 && sizeof(parts) == 0)) {
+	/* a string that is not empty has at least one part */
+	parts += ({ str[start ..] });
+    }
+    return parts;
+}
+
+/*
+ * show an array of strings
+ */
+private string show(string *parts)
+{
+    return "({ \"" + implode(parts, "\", \"") + "\" }) " + sizeof(parts);
+}
+
+static void tests()
+{
+    string *strs, *seps, a, b;
+    int i, j;
+
+    strs = ({ "", "a", "ab", "abc", ",", ",,", "a,", ",a", "a,b", ",a,,b,",
+	      "aaaa", "aaaaa", "abababa", "xabcabcx", "abcab", "a\0b\0\0c",
+	      "the quick brown fox jumps over the lazy dog" });
+    seps = ({ ",", "a", "aa", "ab", "aba", "abc", "\0", "\0\0", "the ",
+	      " ", "o", "dog", "longer than any of the strings" });
+    for (i = 0; i < sizeof(strs); i++) {
+	for (j = 0; j < sizeof(seps); j++) {
+	    expect(show(explode(strs[i], seps[j])),
+		   show(slow_explode(strs[i], seps[j])),
+		   "explode(\"" + strs[i] + "\", \"" + seps[j] + "\")");
+	}
+    }
+    expect(show(explode("a,,b,", ",")), "({ \"a\", \"\", \"b\" }) 3",
+	   "explode known answer");
+    expect(implode(explode("x--y----z", "--"), "+"), "x+y++z",
+	   "implode(explode())");
+
+    expect(sscanf("key = value;", "%s = %s;", a, b), 2, "sscanf literal");
+    expect(a + "|" + b, "key|value", "sscanf literal values");
+    expect(sscanf("a=b=c", "%s=%s", a, b), 2, "sscanf first match");
+    expect(a + "|" + b, "a|b=c", "sscanf first match values");
+    expect(sscanf("aaab", "%sab", a), 1, "sscanf overlapping literal");
+    expect(a, "aa", "sscanf overlapping literal value");
+    expect(sscanf("x-->y", "%s->%s", a, b), 2, "sscanf partial literal");
+    expect(a + "|" + b, "x-|y", "sscanf partial literal values");
+    expect(sscanf("abc", "%s->%s", a, b), 0, "sscanf missing literal");
+    expect(sscanf("abc", "%sbc", a), 1, "sscanf literal at end");
+    expect(a, "a", "sscanf literal at end value");
+}
+
+static void benchmarks()
+{
+    string line, text, *lines, a, b;
+    int i;
+
+    line = "the quick brown fox jumps over the lazy dog\n";
+    text = line;
+    while (strlen(text) < 30000) {
+	text += text;
+    }
+    text = text[.. 29999];
+    begin();
+    for (i = 0; i < 2000; i++) {
+	lines = explode(text, "\n");
+    }
+    end("2000 explodes of 30000 bytes into lines");
+    begin();
+    for (i = 0; i < 2000; i++) {
+	implode(lines, "\n");
+    }
+    end("2000 implodes of " + sizeof(lines) + " lines");
+    line = text[.. 9999] + "<->" + line;
+    begin();
+    for (i = 0; i < 20000; i++) {
+	sscanf(line, "%s<->%s", a, b);
+    }
+    end("20000 sscanf literal searches in 10000 bytes");
+}
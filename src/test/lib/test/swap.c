@@ -0,0 +1,116 @@
+/*
+ * dataspaces saved to the swap file and loaded again, with strings appended
+ * to the saved string table, or the table rebuilt when too much of it is
+ * unused
+ */
+inherit "/lib/test";
+
+private string *strs;		/* strings in the dataspace of a clone */
+private string extra;		/* another string */
+private object clone;		/* clone that holds the strings */
+private string *expected;	/* expected strings */
+
+/*
+ * called in the clone
+ */
+void init(int n)
+{
+    int i;
+
+    strs = allocate(n);
+    for (i = 0; i < n; i++) {
+	strs[i] = "string " + i;
+    }
+}
+
+void set(int i, string str)
+{
+    if (i < 0) {
+	extra = str;
+    } else {
+	strs[i] = str;
+    }
+}
+
+string *query()
+{
+    return ({ extra }) + strs;
+}
+
+/*
+ * change strings in the clone, and check them after it has been swapped
+ * out
+ */
+private void change(int from, int to, string prefix, string func)
+{
+    int i;
+
+    for (i = from; i < to; i++) {
+	clone->set(i, prefix + i);
+	expected[i + 1] = prefix + i;
+    }
+    swapout();
+    later(func);
+}
+
+/*
+ * check the strings in the clone
+ */
+private void verify(string name)
+{
+    string *result;
+    int i;
+
+    result = clone->query();
+    expect(sizeof(result), sizeof(expected), name + " size");
+    for (i = 0; i < sizeof(expected); i++) {
+	expect(result[i], expected[i], name + " " + i);
+    }
+}
+
+static void tests()
+{
+    clone = clone_object(this_object());
+    clone->init(200);
+    expected = clone->query();
+    swapout();
+    later("saved");
+}
+
+static void saved()
+{
+    verify("saved");
+
+    /* a few strings replaced, one by a string already present */
+    clone->set(-1, "extra");
+    expected[0] = "extra";
+    clone->set(5, "string 6");
+    expected[6] = "string 6";
+    change(10, 30, "appended ", "appended");
+}
+
+static void appended()
+{
+    verify("appended");
+    change(30, 40, "appended again ", "appendedAgain");
+}
+
+static void appendedAgain()
+{
+    verify("appended again");
+
+    /* most strings replaced */
+    change(0, 180, "rebuilt ", "rebuilt");
+}
+
+static void rebuilt()
+{
+    verify("rebuilt");
+    change(180, 190, "appended after rebuild ", "final");
+}
+
+static void final()
+{
+    verify("final");
+    destruct_object(clone);
+}
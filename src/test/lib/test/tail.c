@@ -0,0 +1,152 @@
+/*
+ * local function calls in tail position, which replace the frame of the
+ * calling function
+ */
+inherit "/lib/test";
+
+/*
+ * count down with tail calls
+ */
+private int loop(int n, int acc)
+{
+    if (n == 0) {
+	return acc;
+    }
+    return loop(n - 1, acc + 1);
+}
+
+/*
+ * call depth, after n tail calls
+ */
+private int depth(int n)
+{
+    if (n == 0) {
+	return sizeof(call_trace());
+    }
+    return depth(n - 1);
+}
+
+/*
+ * call depth, after n calls from atomic functions
+ */
+private atomic int atomicDepth(int n)
+{
+    if (n == 0) {
+	return sizeof(call_trace());
+    }
+    return atomicDepth(n - 1);
+}
+
+/*
+ * call depth, after n calls from catch blocks
+ */
+private int catchDepth(int n)
+{
+    if (n == 0) {
+	return sizeof(call_trace());
+    }
+    catch {
+	return catchDepth(n - 1);
+    }
+}
+
+/*
+ * call depth, after n calls from rlimits blocks
+ */
+private int rlimitsDepth(int n)
+{
+    if (n == 0) {
+	return sizeof(call_trace());
+    }
+    rlimits (-1; -1) {
+	return rlimitsDepth(n - 1);
+    }
+}
+
+/*
+ * recurse with resource limits
+ */
+private int limited(int depth, int n)
+{
+    rlimits (depth; -1) {
+	return loop(n, 0);
+    }
+}
+
+private mixed untyped(int n, mixed end);
+
+/*
+ * typed function that calls an untyped one in tail position
+ */
+private int typed(int n, mixed end)
+{
+    if (n == 0) {
+	return end;
+    }
+    return untyped(n - 1, end);
+}
+
+/*
+ * untyped function that calls a typed one in tail position
+ */
+private mixed untyped(int n, mixed end)
+{
+    if (n == 0) {
+	return end;
+    }
+    return typed(n - 1, end);
+}
+
+/*
+ * tail calls with a varying number of arguments
+ */
+private int optional(int n, varargs int acc, int flag)
+{
+    if (n == 0) {
+	return (flag) ? -1 : acc;
+    }
+    if (n & 1) {
+	return optional(n - 1, acc + 1);
+    }
+    return optional(n - 1, acc + 1, 1);
+}
+
+/*
+ * tail calls with an ellipsis
+ */
+private int ellipsis(int n, int acc...)
+{
+    if (n == 0) {
+	return sizeof(acc);
+    }
+    return ellipsis(n - 1, 1, 2, 3);
+}
+
+static void tests()
+{
+    string err;
+    int base;
+
+    /* constant call depth */
+    expect(loop(1000000, 0), 1000000, "1000000 tail calls");
+    expect(limited(100, 10000), 10000, "tail calls within maximum depth");
+    base = depth(0);
+    expect(depth(10), base, "call depth after tail calls");
+
+    /* no tail calls from atomic functions, catch or rlimits */
+    expect(atomicDepth(10), base + 10, "call depth from atomic functions");
+    expect(catchDepth(10), base + 10, "call depth from catch");
+    expect(rlimitsDepth(10), base + 10, "call depth from rlimits");
+
+    /* return types */
+    expect(typed(1000000, 7), 7, "typed and untyped tail calls");
+    expect(typed(1000001, 7), 7, "untyped and typed tail calls");
+    err = catch(typed(1000, "seven"));
+    expect(err, "Value is not an int", "return type of typed function");
+    err = catch(typed(1001, "seven"));
+    expect(err, "Value is not an int", "return type passed on by tail calls");
+
+    /* varargs */
+    expect(optional(100001), 100001, "varargs tail calls");
+    expect(ellipsis(100000, 1), 3, "ellipsis tail calls");
+}